@@ -0,0 +1,147 @@
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "asset.h"
+
+/* Bytes a font blob must have for its cell size */
+static size_t font_size(const AssetEntry *e) {
+    size_t size = sizeof(((GlyphAtlas *)0)->masks);
+    if (e->flags & 1) size += (size_t)GLYPH_COUNT * GLYPH_H * e->width * sizeof(uint16_t);
+    return size;
+}
+
+/* Check one entry against the mapping, so accessors never need to */
+static int entry_valid(const AssetPack *p, const AssetEntry *e) {
+    if (e->offset > p->size || e->size > p->size - e->offset) return 0;
+    if (e->offset % ASSET_DATA_ALIGN) return 0;
+    if (e->name >= p->size || !memchr(p->base + e->name, '\0', p->size - e->name)) return 0;
+
+    switch (e->type) {
+    case ASSET_IMAGE:
+        return e->stride >= e->width * 2 && e->stride % 2 == 0 &&
+               (size_t)e->stride * e->height <= e->size;
+    case ASSET_FONT:
+        return e->stride >= 1 && e->stride <= GLYPH_MAX_SCALE &&
+               e->width == GLYPH_W * e->stride && e->height == GLYPH_H * e->stride &&
+               e->size == font_size(e);
+    case ASSET_SOUND:
+        return e->size % 2 == 0;
+    default:
+        return 1;
+    }
+}
+
+int asset_pack_open(AssetPack *p, const char *path) {
+    memset(p, 0, sizeof(*p));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(AssetHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Read-only and private: pages are shared with the page cache and only
+    // faulted in when an asset is actually touched
+    p->size = st.st_size;
+    p->base = mmap(NULL, p->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p->base == MAP_FAILED) {
+        p->base = NULL;
+        return -1;
+    }
+
+    const AssetHeader *h = (const AssetHeader *)p->base;
+    if (h->magic != ASSET_MAGIC || h->version != ASSET_VERSION || h->file_size != p->size ||
+        h->count > (p->size - sizeof(*h)) / sizeof(AssetEntry)) {
+        goto fail;
+    }
+    p->entries = (const AssetEntry *)(p->base + sizeof(*h));
+    p->count = h->count;
+    for (uint32_t i = 0; i < p->count; i++) {
+        if (!entry_valid(p, &p->entries[i])) goto fail;
+        if (i > 0 && p->entries[i].hash < p->entries[i - 1].hash) goto fail;
+    }
+    return 0;
+
+fail:
+    asset_pack_close(p);
+    errno = EINVAL;
+    return -1;
+}
+
+void asset_pack_close(AssetPack *p) {
+    if (p->base) munmap(p->base, p->size);
+    p->base = NULL;
+    p->entries = NULL;
+    p->count = 0;
+}
+
+const AssetEntry *asset_find(const AssetPack *p, const char *name) {
+    uint32_t hash = asset_hash(name);
+
+    // Lower bound on the hash, then compare names across any collisions
+    uint32_t lo = 0, hi = p->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (p->entries[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    for (; lo < p->count && p->entries[lo].hash == hash; lo++) {
+        if (strcmp((const char *)p->base + p->entries[lo].name, name) == 0) return &p->entries[lo];
+    }
+    return NULL;
+}
+
+static const AssetEntry *find_type(const AssetPack *p, const char *name, AssetType type) {
+    const AssetEntry *e = asset_find(p, name);
+    return e && e->type == type ? e : NULL;
+}
+
+int asset_image(const AssetPack *p, const char *name, Canvas *out) {
+    const AssetEntry *e = find_type(p, name, ASSET_IMAGE);
+    if (!e) return -1;
+    out->pixels = p->base + e->offset;
+    out->stride = e->stride;
+    out->width = e->width;
+    out->height = e->height;
+    return 0;
+}
+
+int asset_font(const AssetPack *p, const char *name, GlyphAtlas *out) {
+    const AssetEntry *e = find_type(p, name, ASSET_FONT);
+    if (!e) return -1;
+    memset(out, 0, sizeof(*out));
+    out->scale = e->stride;
+    out->fg = (uint16_t)e->param;
+    out->bg = (uint16_t)(e->param >> 16);
+    out->opaque = e->flags & 1;
+    out->cell_w = e->width;
+    out->cell_h = e->height;
+    memcpy(out->masks, p->base + e->offset, sizeof(out->masks));
+    if (out->opaque) out->pixels = (uint16_t *)(p->base + e->offset + sizeof(out->masks));
+    return 0;
+}
+
+int asset_sound(const AssetPack *p, const char *name, const int16_t **samples,
+                int *length, int *rate) {
+    const AssetEntry *e = find_type(p, name, ASSET_SOUND);
+    if (!e) return -1;
+    *samples = (const int16_t *)(p->base + e->offset);
+    *length = e->size / 2;
+    if (rate) *rate = e->param;
+    return 0;
+}
+
+const void *asset_data(const AssetPack *p, const char *name, uint32_t *size) {
+    const AssetEntry *e = asset_find(p, name);
+    if (!e) return NULL;
+    if (size) *size = e->size;
+    return p->base + e->offset;
+}
@@ -0,0 +1,100 @@
+#ifndef TRIMUI_ASSET_H
+#define TRIMUI_ASSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "surface.h"
+#include "glyph.h"
+
+/* Asset pack file format (little-endian, written by tools/mkpack.c)
+ *
+ *   AssetHeader
+ *   AssetEntry[count]      sorted by (hash, name)
+ *   names                  NUL-terminated strings
+ *   data                   each blob starts on an ASSET_DATA_ALIGN boundary
+ *
+ * Everything is stored in the form the program uses it, so nothing is
+ * decoded at load time:
+ *   image  RGB565 rows of `stride` bytes (chosen when packing, e.g. to
+ *          match finfo.line_length so a full-screen image is one memcpy)
+ *   font   GlyphAtlas masks[GLYPH_COUNT][GLYPH_H], then for opaque fonts
+ *          the expanded pixels, exactly as glyph_atlas_init() builds them
+ *   sound  signed 16-bit mono PCM
+ *   raw    any bytes
+ */
+#define ASSET_MAGIC       0x4B415054u   // "TPAK"
+#define ASSET_VERSION     1
+#define ASSET_DATA_ALIGN  32            // ARM926 cache line
+
+typedef enum {
+    ASSET_RAW = 0,
+    ASSET_IMAGE,
+    ASSET_FONT,
+    ASSET_SOUND,
+} AssetType;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t count;
+    uint32_t file_size;
+} AssetHeader;
+
+typedef struct {
+    uint32_t hash;      // asset_hash(name)
+    uint32_t name;      // file offset of the name
+    uint32_t offset;    // file offset of the data
+    uint32_t size;      // data bytes
+    uint16_t type;      // AssetType
+    uint16_t width;     // image: pixels; font: cell_w
+    uint16_t height;    // image: rows; font: cell_h
+    uint16_t stride;    // image: bytes per row; font: scale
+    uint32_t param;     // font: fg | bg << 16; sound: sample rate
+    uint32_t flags;     // font: 1 = opaque
+} AssetEntry;
+
+/* An asset pack mapped read-only into memory
+ * Every lookup returns pointers into the mapping: no copies, no mallocs.
+ * Everything handed out stays valid until asset_pack_close().
+ */
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    const AssetEntry *entries;
+    uint32_t count;
+} AssetPack;
+
+/* FNV-1a, the hash the entry table is sorted by */
+static inline uint32_t asset_hash(const char *name) {
+    uint32_t h = 2166136261u;
+    for (; *name; name++) h = (h ^ (uint8_t)*name) * 16777619u;
+    return h;
+}
+
+/* Map a pack and check every entry against the file size once
+ * Returns 0, or -1 if the file is missing or malformed.
+ */
+int asset_pack_open(AssetPack *p, const char *path);
+void asset_pack_close(AssetPack *p);
+
+/* Binary search on the hash; NULL if there is no such asset */
+const AssetEntry *asset_find(const AssetPack *p, const char *name);
+
+/* Typed accessors; each returns 0, or -1 if the asset is missing or of another type */
+
+/* The image as a canvas; its pixels are read-only (use it as a blit source) */
+int asset_image(const AssetPack *p, const char *name, Canvas *out);
+
+/* Pre-expanded glyphs; pixels point into the pack, so glyph_atlas_free() is not needed */
+int asset_font(const AssetPack *p, const char *name, GlyphAtlas *out);
+
+/* PCM samples, ready for audio_add_sound() */
+int asset_sound(const AssetPack *p, const char *name, const int16_t **samples,
+                int *length, int *rate);
+
+/* Any asset's bytes */
+const void *asset_data(const AssetPack *p, const char *name, uint32_t *size);
+
+#endif
@@ -0,0 +1,326 @@
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <sys/soundcard.h>
+
+#include "audio.h"
+#include "monotime.h"
+#include "latency.h"
+
+/* Samples per fragment for the largest fragment we accept from the driver */
+#define MIX_MAX_SAMPLES 4096
+
+/* Start the next queued requests on free voices (or steal the oldest one) */
+static void drain_commands(Audio *a) {
+    unsigned head = __atomic_load_n(&a->head, __ATOMIC_ACQUIRE);
+    unsigned tail = a->tail;
+
+    while (tail != head) {
+        AudioCmd cmd = a->ring[tail & (AUDIO_RING_SIZE - 1)];
+        tail++;
+
+        // Acquire pairs with audio_add_sound(): every id below is filled in
+        if (cmd.sound < 0 || cmd.sound >= __atomic_load_n(&a->num_sounds, __ATOMIC_ACQUIRE)) continue;
+
+        Voice *v = &a->voices[0];
+        for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+            if (a->voices[i].sound < 0) {
+                v = &a->voices[i];
+                break;
+            }
+            if (a->voices[i].pos > v->pos) v = &a->voices[i];
+        }
+        v->sound = cmd.sound;
+        v->pos = 0;
+        v->volume = cmd.volume;
+        v->stamp_us = cmd.stamp_us;
+    }
+
+    __atomic_store_n(&a->tail, tail, __ATOMIC_RELEASE);
+}
+
+/* Mix all active voices into `out` */
+static void mix(Audio *a, int16_t *out, int samples) {
+    int32_t acc[MIX_MAX_SAMPLES];
+    memset(acc, 0, samples * sizeof(acc[0]));
+
+    int active = 0;
+    Music *music = __atomic_load_n(&a->music, __ATOMIC_ACQUIRE);
+    if (music) {
+        active++;
+        // A track that has played out is dropped
+        if (!music_mix(music, acc, samples)) {
+            __atomic_compare_exchange_n(&a->music, &music, NULL, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        }
+    }
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        Voice *v = &a->voices[i];
+        if (v->sound < 0) continue;
+        active++;
+
+        const Sound *snd = &a->sounds[v->sound];
+        int n = snd->length - v->pos;
+        if (n > samples) n = samples;
+        const int16_t *src = snd->samples + v->pos;
+        for (int j = 0; j < n; j++) acc[j] += (src[j] * v->volume) >> 8;
+
+        v->pos += n;
+        if (v->pos >= snd->length) v->sound = -1;
+    }
+
+    if (!active) {
+        memset(out, 0, samples * sizeof(out[0]));
+        return;
+    }
+    for (int j = 0; j < samples; j++) {
+        int32_t s = acc[j];
+        if (s > 32767) s = 32767;
+        else if (s < -32768) s = -32768;
+        out[j] = (int16_t)s;
+    }
+}
+
+/* Record press-to-sound latency for voices that start in the fragment just
+ * written; `delay_bytes` is what the device still has to play before it
+ */
+static void account_latency(Audio *a, int delay_bytes) {
+    uint64_t now = 0;
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        Voice *v = &a->voices[i];
+        if (!v->stamp_us) continue;
+        if (!now) now = monotime_us();
+
+        // Time until the device gets to this fragment: what is queued ahead
+        uint64_t queued_us = (uint64_t)(delay_bytes / 2) * 1000000u / a->rate;
+        uint32_t lat = (uint32_t)(now - v->stamp_us + queued_us);
+        latency_record(LAT_AUDIO, lat);
+        a->latency_last_us = lat;
+        if (lat > a->latency_max_us) a->latency_max_us = lat;
+        a->latency_sum_us += lat;
+        a->latency_count++;
+        v->stamp_us = 0;
+    }
+}
+
+static int write_all(int fd, const void *buf, int len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void *mixer_thread(void *arg) {
+    Audio *a = arg;
+    int16_t buf[MIX_MAX_SAMPLES];
+    int samples = a->frag_bytes / 2;
+
+    // Without a device to block on, pace fragments with an absolute clock
+    struct timespec due;
+    clock_gettime(CLOCK_MONOTONIC, &due);
+    long frag_ns = (long)((int64_t)samples * 1000000000 / a->rate);
+
+    while (a->running) {
+        drain_commands(a);
+        mix(a, buf, samples);
+
+        if (a->sink == AUDIO_SINK_OSS) {
+            // An empty driver buffer means we fell behind and playback stalled
+            audio_buf_info info;
+            if (a->fragments > 0 && ioctl(a->fd, SNDCTL_DSP_GETOSPACE, &info) == 0 &&
+                info.bytes >= a->buffer_bytes) {
+                a->underruns++;
+            }
+
+            // Blocks until a fragment is free, which paces the thread
+            if (write_all(a->fd, buf, a->frag_bytes) < 0) return NULL;
+
+            // The queue now ends with this fragment; the rest plays first
+            int delay = 0;
+            if (ioctl(a->fd, SNDCTL_DSP_GETODELAY, &delay) < 0) delay = a->frag_bytes;
+            delay -= a->frag_bytes;
+            account_latency(a, delay > 0 ? delay : 0);
+        } else {
+            if (a->sink == AUDIO_SINK_WAV) {
+                if (write_all(a->fd, buf, a->frag_bytes) < 0) return NULL;
+                a->wav_bytes += a->frag_bytes;
+            }
+            account_latency(a, 0);
+
+            due.tv_nsec += frag_ns;
+            while (due.tv_nsec >= 1000000000) {
+                due.tv_nsec -= 1000000000;
+                due.tv_sec++;
+            }
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR) {}
+        }
+        a->fragments++;
+    }
+    return NULL;
+}
+
+static int start_mixer(Audio *a) {
+    a->running = 1;
+    if (pthread_create(&a->thread, NULL, mixer_thread, a) != 0) {
+        a->running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/* Canonical 44-byte header for mono S16 PCM; sizes are patched on close */
+static void wav_header(uint8_t *h, int rate, uint32_t data_bytes) {
+    static const uint8_t tmpl[44] = {
+        'R','I','F','F', 0,0,0,0, 'W','A','V','E',
+        'f','m','t',' ', 16,0,0,0, 1,0, 1,0, 0,0,0,0, 0,0,0,0, 2,0, 16,0,
+        'd','a','t','a', 0,0,0,0,
+    };
+    memcpy(h, tmpl, sizeof(tmpl));
+    uint32_t fields[4][2] = {
+        { 4, 36 + data_bytes }, { 24, (uint32_t)rate }, { 28, (uint32_t)rate * 2 }, { 40, data_bytes },
+    };
+    for (int i = 0; i < 4; i++) {
+        uint32_t v = fields[i][1];
+        uint8_t *p = h + fields[i][0];
+        p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    }
+}
+
+int audio_open(Audio *a, const char *dev) {
+    memset(a, 0, sizeof(*a));
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) a->voices[i].sound = -1;
+
+    // Fail at once if another process holds the device, then write blocking
+    a->fd = open(dev, O_WRONLY | O_NONBLOCK);
+    if (a->fd < 0) return -1;
+    int flags = fcntl(a->fd, F_GETFL);
+    if (flags < 0 || fcntl(a->fd, F_SETFL, flags & ~O_NONBLOCK) < 0) goto fail;
+
+    // Fragment size must be set before any other format ioctl
+    int frag = (AUDIO_FRAG_COUNT << 16) | AUDIO_FRAG_SHIFT;
+    int fmt = AFMT_S16_LE;
+    int channels = 1;
+    a->rate = AUDIO_RATE;
+    ioctl(a->fd, SNDCTL_DSP_SETFRAGMENT, &frag);
+    if (ioctl(a->fd, SNDCTL_DSP_SETFMT, &fmt) < 0 || fmt != AFMT_S16_LE ||
+        ioctl(a->fd, SNDCTL_DSP_CHANNELS, &channels) < 0 || channels != 1 ||
+        ioctl(a->fd, SNDCTL_DSP_SPEED, &a->rate) < 0) {
+        goto fail;
+    }
+
+    // The driver may round the fragment request; use what it granted
+    audio_buf_info info;
+    if (ioctl(a->fd, SNDCTL_DSP_GETOSPACE, &info) == 0 && info.fragsize > 0) {
+        a->frag_bytes = info.fragsize;
+        a->buffer_bytes = info.fragstotal * info.fragsize;
+    } else {
+        a->frag_bytes = 1 << AUDIO_FRAG_SHIFT;
+        a->buffer_bytes = a->frag_bytes * AUDIO_FRAG_COUNT;
+    }
+    if (a->frag_bytes > MIX_MAX_SAMPLES * 2) a->frag_bytes = MIX_MAX_SAMPLES * 2;
+
+    if (start_mixer(a) < 0) goto fail;
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        close(a->fd);
+        a->fd = -1;
+        errno = saved;
+    }
+    return -1;
+}
+
+int audio_open_wav(Audio *a, const char *path) {
+    memset(a, 0, sizeof(*a));
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) a->voices[i].sound = -1;
+
+    a->sink = path ? AUDIO_SINK_WAV : AUDIO_SINK_NULL;
+    a->fd = -1;
+    a->rate = AUDIO_RATE;
+    a->frag_bytes = 1 << AUDIO_FRAG_SHIFT;
+    a->buffer_bytes = a->frag_bytes * AUDIO_FRAG_COUNT;
+
+    if (path) {
+        a->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (a->fd < 0) return -1;
+        uint8_t h[44];
+        wav_header(h, a->rate, 0);
+        if (write_all(a->fd, h, sizeof(h)) < 0) goto fail;
+    }
+
+    if (start_mixer(a) < 0) goto fail;
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        if (a->fd >= 0) close(a->fd);
+        a->fd = -1;
+        errno = saved;
+    }
+    return -1;
+}
+
+void audio_close(Audio *a) {
+    if (a->running) {
+        a->running = 0;
+        pthread_join(a->thread, NULL);
+    }
+    if (a->sink == AUDIO_SINK_WAV && a->fd >= 0) {
+        uint8_t h[44];
+        wav_header(h, a->rate, a->wav_bytes);
+        ssize_t n = pwrite(a->fd, h, sizeof(h), 0);
+        (void)n;
+    }
+    if (a->fd >= 0) close(a->fd);
+    a->fd = -1;
+}
+
+int audio_add_sound(Audio *a, const int16_t *samples, int length) {
+    // The mixer may be running: fill the slot, then publish it
+    int id = a->num_sounds;
+    if (id == AUDIO_MAX_SOUNDS) return -1;
+    a->sounds[id].samples = samples;
+    a->sounds[id].length = length;
+    __atomic_store_n(&a->num_sounds, id + 1, __ATOMIC_RELEASE);
+    return id;
+}
+
+int audio_play(Audio *a, int sound, int volume, uint64_t stamp_us) {
+    unsigned head = a->head;
+    unsigned tail = __atomic_load_n(&a->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= AUDIO_RING_SIZE) {
+        a->dropped++;
+        return -1;
+    }
+
+    AudioCmd *cmd = &a->ring[head & (AUDIO_RING_SIZE - 1)];
+    cmd->sound = (int16_t)sound;
+    cmd->volume = (int16_t)volume;
+    cmd->stamp_us = stamp_us;
+    __atomic_store_n(&a->head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void audio_set_music(Audio *a, Music *m) {
+    __atomic_store_n(&a->music, m, __ATOMIC_RELEASE);
+}
+
+void audio_square_wave(int16_t *dst, int length, int rate, int freq, int16_t amplitude) {
+    int half = rate / (2 * freq);
+    if (half < 1) half = 1;
+    for (int i = 0; i < length; i++) {
+        dst[i] = (i / half) & 1 ? -amplitude : amplitude;
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef TRIMUI_AUDIO_H
+#define TRIMUI_AUDIO_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "music.h"
+
+#define AUDIO_RATE        22050   // mono, signed 16-bit
+#define AUDIO_FRAG_SHIFT  9       // 512-byte fragments = 256 samples ≈ 11.6 ms
+#define AUDIO_FRAG_COUNT  4
+#define AUDIO_MAX_SOUNDS  16
+#define AUDIO_MAX_VOICES  8
+#define AUDIO_RING_SIZE   64      // must be a power of two
+
+/* Where mixed audio goes */
+typedef enum {
+    AUDIO_SINK_OSS = 0,     // /dev/dsp, paced by the driver
+    AUDIO_SINK_WAV,         // WAV file, paced by the clock (headless runs)
+    AUDIO_SINK_NULL,        // discarded, paced by the clock
+} AudioSink;
+
+/* A preloaded PCM sound effect (mono S16 at AUDIO_RATE, owned by the caller) */
+typedef struct {
+    const int16_t *samples;
+    int length;
+} Sound;
+
+typedef struct {
+    int sound;          // index into Audio.sounds, -1 = free
+    int pos;            // next sample to mix
+    int volume;         // 0..256
+    uint64_t stamp_us;  // when the sound was requested, 0 = unknown
+} Voice;
+
+/* Play request passed from the input thread to the mixer thread */
+typedef struct {
+    int16_t sound;
+    int16_t volume;
+    uint64_t stamp_us;
+} AudioCmd;
+
+/* Persistent OSS mixer
+ *
+ * /dev/dsp is opened once with small fragments, and a dedicated thread mixes
+ * up to AUDIO_MAX_VOICES sounds into it. audio_play() only writes into a
+ * single-producer/single-consumer ring, so triggering a sound from the input
+ * path costs no syscall and never blocks.
+ */
+typedef struct {
+    AudioSink sink;
+    int fd;                 // OSS device or WAV file, -1 for the null sink
+    uint32_t wav_bytes;     // PCM bytes written to a WAV file so far
+    int rate;
+    int frag_bytes;
+    int buffer_bytes;       // whole driver buffer (all fragments)
+    pthread_t thread;
+    volatile int running;
+
+    Sound sounds[AUDIO_MAX_SOUNDS];
+    int num_sounds;
+    Voice voices[AUDIO_MAX_VOICES];   // touched by the mixer thread only
+
+    Music *music;           // streamed under the effects, NULL = none
+
+    AudioCmd ring[AUDIO_RING_SIZE];
+    unsigned head;          // next slot to write, owned by audio_play()
+    unsigned tail;          // next slot to read, owned by the mixer
+
+    // Statistics, written by the mixer thread (dropped: by audio_play)
+    uint32_t fragments;     // fragments written to the device
+    uint32_t underruns;     // times the device buffer was found empty
+    uint32_t dropped;       // play requests lost because the ring was full
+    uint32_t latency_last_us;
+    uint32_t latency_max_us;
+    uint64_t latency_sum_us;
+    uint32_t latency_count;
+} Audio;
+
+/* Open the OSS device and start the mixer thread; returns 0 or -1 */
+int audio_open(Audio *a, const char *dev);
+void audio_close(Audio *a);
+
+/* Same mixer writing a WAV file, or nowhere if `path` is NULL; returns 0 or -1 */
+int audio_open_wav(Audio *a, const char *path);
+
+/* Register a sound effect, also while the mixer runs (from one thread);
+ * returns its id, or -1 if the table is full
+ */
+int audio_add_sound(Audio *a, const int16_t *samples, int length);
+
+/* Queue a sound (volume 0..256). `stamp_us` is the CLOCK_MONOTONIC time of
+ * the triggering event, used to measure press-to-sound latency (0 = skip).
+ * Returns 0, or -1 if the ring is full and the request was dropped.
+ */
+int audio_play(Audio *a, int sound, int volume, uint64_t stamp_us);
+
+/* Mix a streaming music track under the sound effects from the next
+ * fragment on (NULL stops it). The Music must stay open until audio_close().
+ */
+void audio_set_music(Audio *a, Music *m);
+
+/* Fill `dst` with a square wave; handy for generating beeps at startup */
+void audio_square_wave(int16_t *dst, int length, int rate, int freq, int16_t amplitude);
+
+#endif
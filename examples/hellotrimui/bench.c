@@ -0,0 +1,722 @@
+/* Micro-benchmarks for the drawing primitives
+ *
+ * Runs every primitive over a set of sizes, alignments and clip cases on a
+ * 320x240 canvas in RAM and prints one line per case:
+ *
+ *   name w h step_x step_y align clip px_per_call iters ns_per_call ns_per_px
+ *   mpx_per_s spans_per_call mspans_per_s
+ *
+ * step_x/step_y is the scroll per call of the tile map cases (w x h is then
+ * the view), spans_per_call/mspans_per_s are counted for the rasteriser
+ * cases; all four are 0 where they do not apply. The legacy_* cases are the
+ * per-pixel loops the primitives replaced; the speed-up of clear, fill and
+ * the 2x text over them is printed as a comment at the end.
+ * Lines starting with '#' are comments. Before timing the pixel format
+ * converters, their output is checked against a per-pixel reference; a
+ * mismatch makes the exit status 1. Pass the output of an earlier run
+ * with --baseline to flag every case that got slower than --tolerance
+ * percent; the exit status is then 1. Builds natively or for the device
+ * (see build.sh bench), so the same numbers come from qemu-arm too.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "convert.h"
+#include "font.h"
+#include "gfx.h"
+#include "glyph.h"
+#include "raster.h"
+#include "scale.h"
+#include "tilemap.h"
+
+#define SCREEN_W 320
+#define SCREEN_H 240
+#define MAX_CASES 512
+#define TILE_MAP_W 64           // tiles; 1024x1024 pixels of 16x16 tiles
+#define TILE_MAP_H 64
+
+typedef enum { CLIP_NONE, CLIP_PARTIAL, CLIP_OUT } ClipCase;
+static const char *const clip_names[] = { "none", "partial", "out" };
+
+typedef enum {
+    PRIM_FILL, PRIM_CLEAR, PRIM_LEGACY_FILL_RECT, PRIM_LEGACY_CLEAR, PRIM_COPY, PRIM_BLIT_KEY,
+    PRIM_CHAR_2X, PRIM_TEXT_2X, PRIM_TEXT_2X_OPAQUE, PRIM_LEGACY_CHAR_2X, PRIM_LEGACY_TEXT_2X,
+    PRIM_TILEMAP_PAN, PRIM_TILEMAP_SW,
+    PRIM_FONT_CACHED, PRIM_FONT_MISS,
+    PRIM_SCALE_NEAREST, PRIM_SCALE_ASPECT, PRIM_SCALE_SMOOTH, PRIM_SCALE_INTEGER,
+    PRIM_CONVERT_XRGB, PRIM_CONVERT_XRGB_DITHER, PRIM_CONVERT_ARGB,
+    PRIM_CONVERT_BGR565, PRIM_CONVERT_PAL8, PRIM_CONVERT_PAL8_DITHER,
+    PRIM_LINE, PRIM_CIRCLE, PRIM_DISC, PRIM_POLYGON,
+} Prim;
+static const char *const prim_names[] = {
+    "fill", "clear", "legacy_fill_rect", "legacy_clear", "copy", "blit_key", "char_2x", "text_2x", "text_2x_opaque",
+    "legacy_char_2x", "legacy_text_2x",
+    "tilemap_pan", "tilemap_sw",
+    "font_cached", "font_miss",
+    "scale_nearest", "scale_aspect", "scale_smooth", "scale_integer",
+    "convert_xrgb", "convert_xrgb_dither", "convert_argb",
+    "convert_bgr565", "convert_pal8", "convert_pal8_dither",
+    "raster_line", "raster_circle", "raster_disc", "raster_polygon",
+};
+
+typedef struct {
+    Prim prim;
+    int w, h;           // requested size (tile maps: the view)
+    int step_x, step_y; // tile maps only: scroll per call
+    int x, y;           // after alignment and clip offsets
+    int odd;            // x starts on an odd pixel (unaligned head)
+    ClipCase clip;
+    const char *text;   // text primitives only
+    Scaler *scaler;     // scale primitives only, w x h is the source size
+    int spans, px;      // rasteriser only: spans and pixels drawn per call
+    double ns_per_call; // measured, 0 = not run
+} Case;
+
+typedef struct {
+    char key[80];
+    double ns_per_call;
+} BaselineRow;
+
+static Canvas screen;
+static Canvas sprite;
+static const GlyphAtlas *opaque_2x;
+
+// Tile maps on memory surfaces: [0] hardware panned, [1] software scrolled
+static Surface tile_surf[2];
+static TileMap tilemaps[2];
+static uint16_t tile_map[TILE_MAP_W * TILE_MAP_H];
+static int tile_dir[2] = { 1, 1 };
+
+// The built-in font as a PSF2 file: [0] caches every glyph, [1] holds one
+static uint8_t psf[32 + GLYPH_COUNT * GLYPH_H + GLYPH_COUNT * 2];
+static Font font;
+static FontCache font_caches[2];
+
+// Emulator frame sizes scaled to the screen, in each mode
+static const int scale_sizes[][2] = { { 256, 224 }, { 240, 160 }, { 160, 144 } };
+static Scaler scalers[4][3];
+
+// Full-screen sources for the converters, one per PRIM_CONVERT_* case
+static const PixelFormat convert_fmts[] = {
+    PIXFMT_XRGB8888, PIXFMT_XRGB8888, PIXFMT_ARGB8888, PIXFMT_BGR565, PIXFMT_PAL8, PIXFMT_PAL8,
+};
+static Converter converters[6];
+static uint32_t convert_src32[SCREEN_W * SCREEN_H];
+static uint16_t convert_src16[SCREEN_W * SCREEN_H];
+static uint8_t convert_src8[SCREEN_W * SCREEN_H];
+static uint32_t convert_palette[256];
+
+// Five-pointed star (concave) on a 1024x1024 grid, scaled to each case
+static const RasterPoint star[10] = {
+    { 512, 0 }, { 632, 346 }, { 999, 354 }, { 707, 575 }, { 813, 926 },
+    { 512, 717 }, { 211, 926 }, { 317, 575 }, { 25, 354 }, { 392, 346 },
+};
+
+// The text cases draw the app's title
+static const char title[] = "Hello Trimui";
+
+static Case cases[MAX_CASES];
+static int num_cases;
+
+/* The fill_rect(), background clear and draw_char_2x() loops from before
+ * gfx.c and glyph.c, kept as is for reference: one 16-bit store per pixel
+ * and a sign test per pixel, or a bit test per font pixel. fill_rect() never
+ * clipped against the right or bottom edge and draw_char_2x() not at all,
+ * so they only get cases that stay inside those.
+ */
+static void legacy_fill_rect(uint8_t *fbp, int stride, int x, int y, int w, int h, uint16_t color) {
+    for (int yy = y; yy < y + h; yy++) {
+        if (yy < 0) continue;
+        uint16_t *row = (uint16_t *)(fbp + yy * stride);
+        for (int xx = x; xx < x + w; xx++) {
+            if (xx < 0) continue;
+            row[xx] = color;
+        }
+    }
+}
+
+static void legacy_clear(uint8_t *fbp, int stride, int width, int height, uint16_t bg) {
+    for (int y = 0; y < height; y++) {
+        uint16_t *row = (uint16_t *)(fbp + y * stride);
+        for (int x = 0; x < width; x++) {
+            row[x] = bg;
+        }
+    }
+}
+
+// Defined in font8x8_basic.h, which glyph.c includes
+extern char font8x8_basic[128][8];
+
+static void legacy_draw_char_2x(uint8_t *fbp, int stride, int x, int y, char c, uint16_t color) {
+    if (c < 0 || c > 127) return;
+
+    const unsigned char *glyph = (const unsigned char *)font8x8_basic[(int)c];
+
+    for (int row = 0; row < 8; row++) {
+        uint8_t bits = glyph[row];
+
+        for (int col = 0; col < 8; col++) {
+            if (bits & (1 << col)) {
+                for (int dy = 0; dy < 2; dy++) {
+                    uint16_t *dst = (uint16_t *)(fbp + (y + row*2 + dy) * stride
+                                                 + (x + col*2) * 2);
+                    dst[0] = color;
+                    dst[1] = color;
+                }
+            }
+        }
+    }
+}
+
+static void legacy_draw_text_2x(uint8_t *fbp, int stride, int x, int y,
+                                const char *text, uint16_t color) {
+    while (*text) {
+        legacy_draw_char_2x(fbp, stride, x, y, *text, color);
+        x += 16; // 8px * 2 scale
+        text++;
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void canvas_alloc(Canvas *c, int w, int h) {
+    c->width = w;
+    c->height = h;
+    c->stride = w * 2;
+    c->pixels = calloc(h, c->stride);
+    if (!c->pixels) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+}
+
+/* Pixels actually written once the case is clipped to the screen */
+static int visible_pixels(const Case *c) {
+    // Tile maps: the strips that scroll into view
+    if (c->prim == PRIM_TILEMAP_PAN || c->prim == PRIM_TILEMAP_SW) {
+        return c->step_x * c->h + c->step_y * c->w;
+    }
+    if (c->scaler) return c->scaler->out.w * c->scaler->out.h;
+    if (c->prim >= PRIM_LINE) return c->px;
+    int x0 = c->x < 0 ? 0 : c->x;
+    int y0 = c->y < 0 ? 0 : c->y;
+    int x1 = c->x + c->w > SCREEN_W ? SCREEN_W : c->x + c->w;
+    int y1 = c->y + c->h > SCREEN_H ? SCREEN_H : c->y + c->h;
+    return x1 > x0 && y1 > y0 ? (x1 - x0) * (y1 - y0) : 0;
+}
+
+/* Returns the spans drawn (rasteriser cases only) */
+static int run_once(const Case *c) {
+    switch (c->prim) {
+    case PRIM_FILL:
+        gfx_fill(&screen, c->x, c->y, c->w, c->h, 0x001F);
+        break;
+    case PRIM_CLEAR:
+        gfx_clear(&screen, 0x001F);
+        break;
+    case PRIM_LEGACY_FILL_RECT:
+        legacy_fill_rect(screen.pixels, screen.stride, c->x, c->y, c->w, c->h, 0x001F);
+        break;
+    case PRIM_LEGACY_CLEAR:
+        legacy_clear(screen.pixels, screen.stride, SCREEN_W, SCREEN_H, 0x001F);
+        break;
+    case PRIM_COPY:
+        gfx_copy(&screen, c->x, c->y, &sprite, 0, 0, c->w, c->h);
+        break;
+    case PRIM_BLIT_KEY:
+        gfx_blit_key(&screen, c->x, c->y, &sprite, 0, 0, c->w, c->h, 0xF81F);
+        break;
+    case PRIM_CHAR_2X:
+    case PRIM_TEXT_2X:
+        draw_text_2x(&screen, c->x, c->y, c->text, 0xFFFF);
+        break;
+    case PRIM_TEXT_2X_OPAQUE:
+        draw_text(&screen, c->x, c->y, c->text, opaque_2x);
+        break;
+    case PRIM_LEGACY_CHAR_2X:
+    case PRIM_LEGACY_TEXT_2X:
+        legacy_draw_text_2x(screen.pixels, screen.stride, c->x, c->y, c->text, 0xFFFF);
+        break;
+    case PRIM_TILEMAP_PAN:
+    case PRIM_TILEMAP_SW: {
+        // Bounce between the edges of the map
+        int i = c->prim == PRIM_TILEMAP_SW;
+        TileMap *tm = &tilemaps[i];
+        int x = tm->view_x + tile_dir[i] * c->step_x, y = tm->view_y + tile_dir[i] * c->step_y;
+        if (x < 0 || y < 0 || x > TILE_MAP_W * 16 - SCREEN_W || y > TILE_MAP_H * 16 - SCREEN_H) {
+            tile_dir[i] = -tile_dir[i];
+            x = tm->view_x + tile_dir[i] * c->step_x;
+            y = tm->view_y + tile_dir[i] * c->step_y;
+        }
+        tilemap_scroll_to(tm, x, y);
+        surface_flush(tm->surf);
+        break;
+    }
+    case PRIM_FONT_CACHED:
+    case PRIM_FONT_MISS:
+        font_draw_text(&screen, c->x, c->y, c->text, &font_caches[c->prim == PRIM_FONT_MISS]);
+        break;
+    case PRIM_SCALE_NEAREST:
+    case PRIM_SCALE_ASPECT:
+    case PRIM_SCALE_SMOOTH:
+    case PRIM_SCALE_INTEGER: {
+        // The top-left of the sprite sheet stands in for the emulator frame
+        Canvas frame = { sprite.pixels, sprite.stride, c->w, c->h };
+        scaler_run(c->scaler, &screen, &frame);
+        break;
+    }
+    case PRIM_LINE:
+        return raster_line(&screen, c->x, c->y, c->x + c->w - 1, c->y + c->h - 1, 0xFFE0);
+    case PRIM_CIRCLE:
+    case PRIM_DISC:
+        return raster_circle(&screen, c->x + c->w / 2, c->y + c->h / 2, (c->w - 1) / 2, 0xFFE0,
+                             c->prim == PRIM_DISC);
+    case PRIM_POLYGON: {
+        RasterPoint pts[10];
+        for (int i = 0; i < 10; i++) {
+            pts[i].x = c->x + star[i].x * (c->w - 1) / 1024;
+            pts[i].y = c->y + star[i].y * (c->h - 1) / 1024;
+        }
+        return raster_polygon(&screen, pts, 10, 0xFFE0);
+    }
+    default: {
+        const Converter *cv = &converters[c->prim - PRIM_CONVERT_XRGB];
+        const void *src = cv->fmt == PIXFMT_PAL8 ? (const void *)convert_src8 :
+                          cv->fmt == PIXFMT_BGR565 ? (const void *)convert_src16 : convert_src32;
+        int bpp = cv->fmt == PIXFMT_PAL8 ? 1 : cv->fmt == PIXFMT_BGR565 ? 2 : 4;
+        convert_blit(cv, &screen, c->x, c->y, src, SCREEN_W * bpp, c->w, c->h);
+        break;
+    }
+    }
+    return 0;
+}
+
+static Case *add_case(Prim prim, int w, int h, int odd, ClipCase clip, const char *text) {
+    static Case overflow;
+    if (num_cases == MAX_CASES) return &overflow;
+    Case *c = &cases[num_cases++];
+    c->prim = prim;
+    c->w = w;
+    c->h = h;
+    c->odd = odd;
+    c->clip = clip;
+    c->text = text;
+
+    // Unclipped cases sit in the middle of the screen where they fit
+    c->x = w < SCREEN_W ? ((SCREEN_W - w) / 2 & ~1) : 0;
+    c->y = h < SCREEN_H ? (SCREEN_H - h) / 2 : 0;
+    if (odd) c->x |= 1;
+    if (clip == CLIP_PARTIAL) {
+        // Hang off the top-left corner: a quarter stays visible
+        c->x = -(w / 2) + odd;
+        c->y = -(h / 2);
+    } else if (clip == CLIP_OUT) {
+        c->x = SCREEN_W + 8 + odd;
+    }
+    return c;
+}
+
+static void build_cases(void) {
+    static const int sizes[][2] = { { 8, 8 }, { 32, 32 }, { 64, 16 }, { 320, 16 }, { 320, 240 } };
+    static const Prim rects[] = { PRIM_FILL, PRIM_COPY, PRIM_BLIT_KEY };
+    int title_w = 16 * (int)strlen(title);
+
+    add_case(PRIM_CLEAR, SCREEN_W, SCREEN_H, 0, CLIP_NONE, NULL);
+    add_case(PRIM_LEGACY_CLEAR, SCREEN_W, SCREEN_H, 0, CLIP_NONE, NULL);
+    for (int s = 0; s < 5; s++) {
+        for (int odd = 0; odd < 2; odd++) {
+            if (odd && sizes[s][0] == SCREEN_W) continue;  // would run off the right edge
+            for (int clip = CLIP_NONE; clip <= CLIP_PARTIAL; clip++) {
+                add_case(PRIM_LEGACY_FILL_RECT, sizes[s][0], sizes[s][1], odd, (ClipCase)clip, NULL);
+            }
+        }
+    }
+    for (int p = 0; p < 3; p++) {
+        for (int s = 0; s < 5; s++) {
+            for (int odd = 0; odd < 2; odd++) {
+                for (int clip = CLIP_NONE; clip <= CLIP_OUT; clip++) {
+                    add_case(rects[p], sizes[s][0], sizes[s][1], odd, (ClipCase)clip, NULL);
+                }
+            }
+        }
+    }
+    for (int odd = 0; odd < 2; odd++) {
+        for (int clip = CLIP_NONE; clip <= CLIP_OUT; clip++) {
+            add_case(PRIM_CHAR_2X, 16, 16, odd, (ClipCase)clip, "A");
+            add_case(PRIM_TEXT_2X, title_w, 16, odd, (ClipCase)clip, title);
+            add_case(PRIM_TEXT_2X_OPAQUE, title_w, 16, odd, (ClipCase)clip, title);
+            add_case(PRIM_FONT_CACHED, title_w / 2, 8, odd, (ClipCase)clip, title);
+            add_case(PRIM_FONT_MISS, title_w / 2, 8, odd, (ClipCase)clip, title);
+        }
+        add_case(PRIM_LEGACY_CHAR_2X, 16, 16, odd, CLIP_NONE, "A");
+        add_case(PRIM_LEGACY_TEXT_2X, title_w, 16, odd, CLIP_NONE, title);
+    }
+
+    static const int steps[][2] = { { 1, 0 }, { 0, 1 }, { 4, 4 }, { 16, 0 }, { 0, 16 } };
+    for (int p = PRIM_TILEMAP_PAN; p <= PRIM_TILEMAP_SW; p++) {
+        for (int s = 0; s < 5; s++) {
+            Case *c = add_case((Prim)p, SCREEN_W, SCREEN_H, 0, CLIP_NONE, NULL);
+            c->step_x = steps[s][0];
+            c->step_y = steps[s][1];
+        }
+    }
+
+    for (int m = 0; m < 4; m++) {
+        for (int s = 0; s < 3; s++) {
+            Case *c = add_case((Prim)(PRIM_SCALE_NEAREST + m), scale_sizes[s][0], scale_sizes[s][1],
+                               0, CLIP_NONE, NULL);
+            c->scaler = &scalers[m][s];
+        }
+    }
+
+    for (int p = PRIM_CONVERT_XRGB; p <= PRIM_CONVERT_PAL8_DITHER; p++) {
+        for (int odd = 0; odd < 2; odd++) {
+            add_case((Prim)p, SCREEN_W - odd, SCREEN_H, odd, CLIP_NONE, NULL);
+            add_case((Prim)p, 64, 16, odd, CLIP_PARTIAL, NULL);
+        }
+    }
+
+    // Lines: horizontal, shallow, diagonal, steep and vertical
+    static const int lines[][2] = { { 320, 1 }, { 320, 64 }, { 240, 240 }, { 16, 240 }, { 1, 240 } };
+    static const int shapes[] = { 8, 32, 128, 240 };
+    for (int clip = CLIP_NONE; clip <= CLIP_OUT; clip++) {
+        for (int s = 0; s < 5; s++) add_case(PRIM_LINE, lines[s][0], lines[s][1], 0, (ClipCase)clip, NULL);
+        for (int p = PRIM_CIRCLE; p <= PRIM_POLYGON; p++) {
+            for (int s = 0; s < 4; s++) add_case((Prim)p, shapes[s], shapes[s], 0, (ClipCase)clip, NULL);
+        }
+    }
+}
+
+/* Spans and pixels each rasteriser case draws, counted on a cleared screen */
+static void measure_raster(void) {
+    for (int i = 0; i < num_cases; i++) {
+        Case *c = &cases[i];
+        if (c->prim < PRIM_LINE) continue;
+        gfx_clear(&screen, 0);
+        c->spans = run_once(c);
+        for (int p = 0; p < SCREEN_W * SCREEN_H; p++) c->px += ((uint16_t *)screen.pixels)[p] != 0;
+    }
+}
+
+/* Gradients (where banding shows) with some noise, half of it transparent */
+static void setup_converters(void) {
+    for (int i = 0; i < 256; i++) convert_palette[i] = (uint32_t)(i * 0x010101) ^ (i & 7) << 20;
+    for (int y = 0; y < SCREEN_H; y++) {
+        for (int x = 0; x < SCREEN_W; x++) {
+            uint32_t p = (uint32_t)(x * 255 / SCREEN_W) << 16 | (uint32_t)(y * 255 / SCREEN_H) << 8 |
+                         (uint32_t)(rand() & 0xFF);
+            int i = y * SCREEN_W + x;
+            convert_src32[i] = p | (x & 1 ? 0xFF000000u : 0x40000000u);
+            convert_src16[i] = (uint16_t)(x * 37 + y * 101);
+            convert_src8[i] = (uint8_t)(x ^ y);
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        convert_init(&converters[i], convert_fmts[i],
+                     i == PRIM_CONVERT_XRGB_DITHER - PRIM_CONVERT_XRGB ||
+                     i == PRIM_CONVERT_PAL8_DITHER - PRIM_CONVERT_XRGB);
+        convert_set_palette(&converters[i], convert_palette, 256);
+    }
+}
+
+/* What convert_span() must produce for one pixel, the slow obvious way */
+static uint16_t convert_reference(uint32_t p, int dither, int x, int y) {
+    int r = p >> 16 & 0xFF, g = p >> 8 & 0xFF, b = p & 0xFF;
+    if (dither) {
+        static const int bayer[4][4] = { { 0, 8, 2, 10 }, { 12, 4, 14, 6 },
+                                         { 3, 11, 1, 9 }, { 15, 7, 13, 5 } };
+        int t = bayer[y & 3][x & 3];
+        r = r + t / 2 > 255 ? 255 : r + t / 2;
+        g = g + t / 4 > 255 ? 255 : g + t / 4;
+        b = b + t / 2 > 255 ? 255 : b + t / 2;
+    }
+    return rgb565(r, g, b);
+}
+
+/* Every format, dither setting, phase, alignment and span length up to 37
+ * against convert_reference(); returns the number of wrong pixels
+ */
+static int check_converters(long *checked) {
+    static const PixelFormat fmts[] = { PIXFMT_XRGB8888, PIXFMT_ARGB8888, PIXFMT_BGR565, PIXFMT_PAL8 };
+    static Converter cv;
+    uint16_t out[48];
+    int bad = 0;
+    *checked = 0;
+
+    for (int f = 0; f < 4; f++) {
+        for (int dither = 0; dither < 2; dither++) {
+            convert_init(&cv, fmts[f], dither);
+            convert_set_palette(&cv, convert_palette, 256);
+            for (int x = 0; x < 4; x++) {
+                for (int y = 0; y < 4; y++) {
+                    for (int n = 0; n <= 37; n++) {
+                        for (int align = 0; align < 2; align++) {
+                            int src_off = (x * 7 + y * 3 + n) % 64;
+                            const uint32_t *s32 = convert_src32 + src_off;
+                            const uint16_t *s16 = convert_src16 + src_off + align;
+                            const uint8_t *s8 = convert_src8 + src_off;
+                            const void *src = fmts[f] == PIXFMT_PAL8 ? (const void *)s8 :
+                                              fmts[f] == PIXFMT_BGR565 ? (const void *)s16 : s32;
+                            for (int i = 0; i < 48; i++) out[i] = 0xDEAD;
+                            convert_span(&cv, out + align, src, n, x, y);
+
+                            for (int i = 0; i < 48; i++) {
+                                uint16_t want = 0xDEAD;
+                                int k = i - align;
+                                if (k >= 0 && k < n) {
+                                    switch (fmts[f]) {
+                                    case PIXFMT_XRGB8888:
+                                        want = convert_reference(s32[k], dither, x + k, y);
+                                        break;
+                                    case PIXFMT_ARGB8888:
+                                        if (s32[k] >> 31) want = convert_reference(s32[k], dither, x + k, y);
+                                        break;
+                                    case PIXFMT_BGR565:
+                                        want = (uint16_t)((s16[k] >> 11) | (s16[k] & 0x07E0) | (s16[k] << 11));
+                                        break;
+                                    case PIXFMT_PAL8:
+                                        want = convert_reference(convert_palette[s8[k]], dither, x + k, y);
+                                        break;
+                                    }
+                                }
+                                if (out[i] != want) bad++;
+                                (*checked)++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return bad;
+}
+
+/* Random 16x16 tiles cut from the sprite sheet */
+static void setup_tilemaps(void) {
+    int sheet_tiles = (SCREEN_W / 16) * (SCREEN_H / 16);
+    for (int i = 0; i < TILE_MAP_W * TILE_MAP_H; i++) tile_map[i] = (uint16_t)(rand() % sheet_tiles);
+
+    for (int i = 0; i < 2; i++) {
+        if (surface_open_memory(&tile_surf[i], SCREEN_W, SCREEN_H, 2) < 0 ||
+            tilemap_init(&tilemaps[i], &tile_surf[i], &sprite, 16, 16,
+                         tile_map, TILE_MAP_W, TILE_MAP_H) < 0) {
+            fprintf(stderr, "tile map setup failed\n");
+            exit(2);
+        }
+    }
+
+    // Memory surfaces can always pan; force the fallback for the second one
+    TileMap *sw = &tilemaps[1];
+    sw->mode = TILEMAP_SOFTWARE;
+    sw->plane = tile_surf[1].back;
+    sw->period_w = sw->period_h = 0;
+
+    for (int i = 0; i < 2; i++) tilemap_scroll_to(&tilemaps[i], 0, 0);
+}
+
+/* PSF2 copy of font8x8_basic with a Unicode table, opened from memory */
+static void setup_font(void) {
+    const GlyphAtlas *a = glyph_atlas_get(1, 0xFFFF, 0, 0);
+    uint32_t header[8] = { 0x864AB572u, 0, 32, 1, GLYPH_COUNT, GLYPH_H, GLYPH_H, GLYPH_W };
+    memcpy(psf, header, sizeof(header));
+
+    uint8_t *p = psf + sizeof(header);
+    for (int g = 0; g < GLYPH_COUNT; g++) {
+        // Atlas masks are LSB = leftmost pixel, PSF2 rows are MSB first
+        for (int r = 0; r < GLYPH_H; r++) {
+            uint8_t bits = 0;
+            for (int x = 0; x < GLYPH_W; x++) {
+                if (a->masks[g][r] & (1u << x)) bits |= 0x80 >> x;
+            }
+            *p++ = bits;
+        }
+    }
+    for (int g = 0; g < GLYPH_COUNT; g++) {
+        *p++ = (uint8_t)g;
+        *p++ = 0xFF;
+    }
+
+    if (font_open_memory(&font, psf, sizeof(psf)) < 0 ||
+        font_cache_init(&font_caches[0], &font, GLYPH_COUNT, 0xFFFF, 0x001F) < 0 ||
+        font_cache_init(&font_caches[1], &font, 1, 0xFFFF, 0x001F) < 0) {
+        fprintf(stderr, "font setup failed\n");
+        exit(2);
+    }
+}
+
+static void case_key(const Case *c, char *key, size_t len) {
+    snprintf(key, len, "%s %d %d %d %d %s %s", prim_names[c->prim], c->w, c->h, c->step_x, c->step_y,
+             c->odd ? "odd" : "even", clip_names[c->clip]);
+}
+
+/* Read rows of an earlier run; returns how many were loaded */
+static int load_baseline(const char *path, BaselineRow *rows, int max) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    int n = 0;
+    char line[256];
+    while (n < max && fgets(line, sizeof(line), f)) {
+        char name[24], align[8], clip[8];
+        int w, h, step_x, step_y, px;
+        unsigned long iters;
+        double ns;
+        if (line[0] == '#' ||
+            sscanf(line, "%23s %d %d %d %d %7s %7s %d %lu %lf", name, &w, &h, &step_x, &step_y,
+                   align, clip, &px, &iters, &ns) != 10) {
+            continue;
+        }
+        snprintf(rows[n].key, sizeof(rows[n].key), "%s %d %d %d %d %s %s", name, w, h, step_x, step_y,
+                 align, clip);
+        rows[n].ns_per_call = ns;
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/* Time of the first case run with this primitive, size and clip; 0 if none */
+static double case_ns(Prim prim, int w, int h, ClipCase clip) {
+    for (int i = 0; i < num_cases; i++) {
+        const Case *c = &cases[i];
+        if (c->prim == prim && c->w == w && c->h == h && c->clip == clip && !c->odd) {
+            return c->ns_per_call;
+        }
+    }
+    return 0.0;
+}
+
+/* Speed-up of a primitive over the legacy loop it replaced, flagged if it
+ * misses `target` (0 = no target)
+ */
+static void print_speedup(const char *name, Prim prim, Prim legacy, int w, int h, double target) {
+    double now = case_ns(prim, w, h, CLIP_NONE);
+    double old = case_ns(legacy, w, h, CLIP_NONE);
+    if (now <= 0.0 || old <= 0.0) return;
+    printf("# speedup %s %dx%d: %.1f ns legacy, %.1f ns now, %.2fx", name, w, h, old, now, old / now);
+    if (target > 0.0 && old / now < target) printf(" (below the %gx target)", target);
+    printf("\n");
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--min-ms N] [--filter NAME] [--baseline FILE] [--tolerance PCT]\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    int min_ms = 20;
+    const char *filter = NULL;
+    const char *baseline_path = NULL;
+    double tolerance = 10.0;
+    for (int i = 1; i < argc; i++) {
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!val) { usage(argv[0]); return 2; }
+        if      (!strcmp(argv[i], "--min-ms"))    min_ms = atoi(val);
+        else if (!strcmp(argv[i], "--filter"))    filter = val;
+        else if (!strcmp(argv[i], "--baseline"))  baseline_path = val;
+        else if (!strcmp(argv[i], "--tolerance")) tolerance = atof(val);
+        else { usage(argv[0]); return 2; }
+        i++;
+    }
+
+    static BaselineRow baseline[MAX_CASES];
+    int num_baseline = baseline_path ? load_baseline(baseline_path, baseline, MAX_CASES) : 0;
+
+    canvas_alloc(&screen, SCREEN_W, SCREEN_H);
+    canvas_alloc(&sprite, SCREEN_W, SCREEN_H);
+    // Sprite: stripes of the colour key, so blit_key skips about half the pixels
+    for (int y = 0; y < SCREEN_H; y++) {
+        uint16_t *row = (uint16_t *)(sprite.pixels + y * sprite.stride);
+        for (int x = 0; x < SCREEN_W; x++) row[x] = (x >> 2) & 1 ? 0xF81F : (uint16_t)(x * 37 + y);
+    }
+    opaque_2x = glyph_atlas_get(2, 0xFFFF, 0x001F, 1);
+    glyph_atlas_get(2, 0xFFFF, 0, 0);   // built here, not inside the timed loop
+    setup_tilemaps();
+    setup_font();
+    for (int m = 0; m < 4; m++) {
+        for (int s = 0; s < 3; s++) {
+            if (scaler_init(&scalers[m][s], (ScaleMode)m, scale_sizes[s][0], scale_sizes[s][1],
+                            SCREEN_W, SCREEN_H) < 0) {
+                fprintf(stderr, "scaler setup failed\n");
+                exit(2);
+            }
+        }
+    }
+    setup_converters();
+    build_cases();
+    measure_raster();
+
+    if (!filter || !strncmp(filter, "convert", 7)) {
+        long checked;
+        int bad = check_converters(&checked);
+        printf("# convert check: %ld pixels, %d wrong\n", checked, bad);
+        if (bad) return 1;
+    }
+
+    uint64_t min_ns = (uint64_t)(min_ms > 0 ? min_ms : 1) * 1000000u;
+    int regressions = 0;
+
+    printf("# name w h step_x step_y align clip px_per_call iters ns_per_call ns_per_px mpx_per_s "
+           "spans_per_call mspans_per_s\n");
+    for (int i = 0; i < num_cases; i++) {
+        Case *c = &cases[i];
+        if (filter && strcmp(filter, prim_names[c->prim]) != 0) continue;
+
+        // Double the iteration count until one run lasts at least min_ns
+        unsigned long iters = 1;
+        uint64_t elapsed;
+        for (;;) {
+            uint64_t t0 = now_ns();
+            for (unsigned long k = 0; k < iters; k++) run_once(c);
+            elapsed = now_ns() - t0;
+            if (elapsed >= min_ns || iters >= (1ul << 30)) break;
+            iters *= 2;
+        }
+
+        int px = visible_pixels(c);
+        double ns_call = (double)elapsed / iters;
+        c->ns_per_call = ns_call;
+        double ns_px = px ? ns_call / px : 0.0;
+        double mpx_s = px ? px * 1000.0 / ns_call : 0.0;
+
+        char key[80];
+        case_key(c, key, sizeof(key));
+        printf("%s %d %lu %.1f %.3f %.2f %d %.2f\n", key, px, iters, ns_call, ns_px, mpx_s,
+               c->spans, c->spans * 1000.0 / ns_call);
+
+        for (int b = 0; b < num_baseline; b++) {
+            if (strcmp(baseline[b].key, key) != 0) continue;
+            if (ns_call > baseline[b].ns_per_call * (1.0 + tolerance / 100.0)) {
+                fprintf(stderr, "regression: %s %.1f -> %.1f ns/call\n",
+                        key, baseline[b].ns_per_call, ns_call);
+                regressions++;
+            }
+            break;
+        }
+    }
+
+    // Only the full-screen clear has a target
+    print_speedup("clear", PRIM_CLEAR, PRIM_LEGACY_CLEAR, SCREEN_W, SCREEN_H, 3.0);
+    print_speedup("fill", PRIM_FILL, PRIM_LEGACY_FILL_RECT, SCREEN_W, SCREEN_H, 0.0);
+    print_speedup("char_2x", PRIM_CHAR_2X, PRIM_LEGACY_CHAR_2X, 16, 16, 0.0);
+    print_speedup("text_2x", PRIM_TEXT_2X, PRIM_LEGACY_TEXT_2X, 16 * (int)strlen(title), 16, 0.0);
+
+    if (!filter || !strncmp(filter, "font_", 5)) {
+        printf("# font cache: cached %u hits %u misses, 1-slot %u hits %u misses\n",
+               font_caches[0].hits, font_caches[0].misses,
+               font_caches[1].hits, font_caches[1].misses);
+    }
+
+    if (num_baseline) {
+        fprintf(stderr, "%d regression(s) beyond %.0f%%\n", regressions, tolerance);
+    }
+    return regressions ? 1 : 0;
+}
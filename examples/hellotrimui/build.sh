@@ -7,12 +7,68 @@ BLUE="\033[1;34m"
 RED="\033[1;31m"
 RESET="\033[0m"
 
+# Sources linked into the hellotrimui binary
+SOURCES="hellotrimui.c surface.c glyph.c gfx.c audio.c music.c runloop.c evdev.c input.c latency.c launcher.c ui.c font.c asset.c evlog.c hud.c capture.c platform.c platform_fbdev.c platform_headless.c"
+
+# Sources linked into the bench binary
+BENCH_SOURCES="bench.c convert.c font.c gfx.c glyph.c raster.c scale.c surface.c tilemap.c"
+
+# ./build.sh bench [host] [bench options]: rendering micro-benchmarks
+# The ARM build uses the container's CFLAGS and runs under qemu-arm there;
+# results go to bench-arm.txt or bench-host.txt, e.g. for --baseline later
+if [ "$1" = "bench" ]; then
+    shift
+    TARGET=arm
+    if [ "$1" = "host" ]; then
+        TARGET=host
+        shift
+    fi
+    STATUS=0
+    if [ "$TARGET" = "host" ]; then
+        echo "${BLUE}▶ Building bench-host with ${CC:-cc}...${RESET}"
+        ${CC:-cc} -O2 -Wall $BENCH_SOURCES -o bench-host
+        ./bench-host "$@" > bench-host.txt || STATUS=$?
+    else
+        echo "${BLUE}▶ Building bench-arm and running it under qemu-arm...${RESET}"
+        podman run --rm \
+            -v "$PWD":/src \
+            trimui-dev \
+            sh -c "cd /src && \$CC \$CFLAGS --static $BENCH_SOURCES \$LDFLAGS -o bench-arm && qemu-arm ./bench-arm $*" \
+            > bench-arm.txt || STATUS=$?
+    fi
+    cat bench-$TARGET.txt
+    if [ "$STATUS" -ne 0 ]; then
+        echo "${RED}✘ bench failed or regressed (exit $STATUS)${RESET}"
+    else
+        echo "${GREEN}✔ Results: ./bench-$TARGET.txt${RESET}"
+    fi
+    exit $STATUS
+fi
+
+# ./build.sh tools: host-side helpers (asset packer, capture decoder, music encoder)
+if [ "$1" = "tools" ]; then
+    echo "${BLUE}▶ Building host tools with ${CC:-cc}...${RESET}"
+    ${CC:-cc} -O2 -Wall tools/mkpack.c glyph.c -o mkpack
+    ${CC:-cc} -O2 -Wall tools/capdump.c -o capdump
+    ${CC:-cc} -O2 -Wall tools/mkadpcm.c music.c -lpthread -o mkadpcm
+    echo "${GREEN}✔ Output: ./mkpack ./capdump ./mkadpcm${RESET}"
+    exit 0
+fi
+
+# ./build.sh host: native build for headless runs, nothing is deployed
+if [ "$1" = "host" ]; then
+    echo "${BLUE}▶ Building hellotrimui-host with ${CC:-cc}...${RESET}"
+    ${CC:-cc} -O2 -Wall $SOURCES -lpthread -o hellotrimui-host
+    echo "${GREEN}✔ Output: ./hellotrimui-host (run with --headless)${RESET}"
+    exit 0
+fi
+
 echo "${BLUE}▶ Building hellotrimui using Docker toolchain...${RESET}"
 
 podman run --rm \
     -v "$PWD":/src \
     trimui-dev \
-    sh -c '$CC $CFLAGS --static /src/hellotrimui.c $LDFLAGS -o /src/hellotrimui'
+    sh -c "cd /src && \$CC \$CFLAGS --static $SOURCES \$LDFLAGS -lpthread -o hellotrimui"
 
 echo "${GREEN}✔ Build complete!${RESET}"
 echo "${GREEN}✔ Output: ./hellotrimui${RESET}"
@@ -25,6 +81,13 @@ adb shell mkdir -p /mnt/SDCARD/Apps/hellotrimui/
 
 echo "${BLUE}▶ Pushing hellotrimui to TrimUI device...${RESET}"
 adb push hellotrimui /mnt/SDCARD/Apps/hellotrimui/
+adb push keymap.cfg /mnt/SDCARD/Apps/hellotrimui/
+if [ -f assets.pak ]; then
+    adb push assets.pak /mnt/SDCARD/Apps/hellotrimui/
+fi
+if [ -f music.wav ]; then
+    adb push music.wav /mnt/SDCARD/Apps/hellotrimui/
+fi
 
 echo "${BLUE}▶ Running hellotrimui on TrimUI device...${RESET}"
 adb shell /mnt/SDCARD/Apps/hellotrimui/hellotrimui
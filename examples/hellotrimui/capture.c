@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "capture.h"
+#include "monotime.h"
+
+/* Nice value of the writer: the render loop comes first on a single core */
+#define CAPTURE_NICE 10
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+uint32_t capture_encode(uint8_t *out, const uint16_t *cur, const uint16_t *prev, int n) {
+    uint16_t *o = (uint16_t *)out;
+    int i = 0;
+    // Key frames are coded against black
+    #define DELTA(k) (prev ? (uint16_t)(cur[k] ^ prev[k]) : cur[k])
+
+    while (i < n) {
+        // Unchanged run, compared two pixels at a time while aligned
+        int j = i;
+        if (j & 1 && !DELTA(j)) j++;
+        if (!(j & 1)) {
+            if (prev) {
+                while (j + 2 <= n && *(const uint32_t *)(cur + j) == *(const uint32_t *)(prev + j)) j += 2;
+            } else {
+                while (j + 2 <= n && *(const uint32_t *)(cur + j) == 0) j += 2;
+            }
+        }
+        while (j < n && !DELTA(j)) j++;
+        while (i < j) {
+            int k = j - i > 0x7FFF ? 0x7FFF : j - i;
+            *o++ = (uint16_t)k;
+            i += k;
+        }
+        if (i == n) break;
+
+        // Changed run; a single unchanged pixel is cheaper kept inside it
+        j = i;
+        while (j < n && (DELTA(j) || (j + 1 < n && DELTA(j + 1)))) j++;
+
+        while (i < j) {
+            // Three or more equal values: one repeat token
+            uint16_t v = DELTA(i);
+            int r = 1;
+            while (i + r < j && r < 0x3FFF && DELTA(i + r) == v) r++;
+            if (r >= 3) {
+                *o++ = (uint16_t)(0xC000 | r);
+                *o++ = v;
+                i += r;
+                continue;
+            }
+
+            // Literal values up to the next such run
+            uint16_t *token = o++;
+            int start = i;
+            while (i < j && i - start < 0x3FFF) {
+                v = DELTA(i);
+                if (i + 2 < j && DELTA(i + 1) == v && DELTA(i + 2) == v) break;
+                *o++ = v;
+                i++;
+            }
+            *token = (uint16_t)(0x8000 | (i - start));
+        }
+    }
+    #undef DELTA
+    return (uint32_t)((uint8_t *)o - out);
+}
+
+static void write_frame(Capture *c, unsigned slot) {
+    int n = c->width * c->height;
+    const uint16_t *cur = c->slots[slot];
+    int key = c->frames_written % CAPTURE_KEY_INTERVAL == 0;
+
+    CaptureFrame f;
+    memset(&f, 0, sizeof(f));
+    f.seq = c->slot_seq[slot];
+    f.t_us = c->slot_t_us[slot];
+    f.flags = key ? CAPTURE_KEY_FRAME : 0;
+    f.size = capture_encode(c->out + sizeof(f), cur, key ? NULL : c->prev, n);
+    memcpy(c->out, &f, sizeof(f));
+
+    if (!c->write_failed && write_all(c->fd, c->out, sizeof(f) + f.size) < 0) c->write_failed = 1;
+    memcpy(c->prev, cur, n * 2);
+    c->frames_written++;
+    c->raw_bytes += n * 2;
+    c->bytes_written += sizeof(f) + f.size;
+}
+
+static void *writer_thread(void *arg) {
+    Capture *c = arg;
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), CAPTURE_NICE);
+
+    for (;;) {
+        while (sem_wait(&c->ready) < 0 && errno == EINTR) {}
+
+        unsigned head = __atomic_load_n(&c->head, __ATOMIC_ACQUIRE);
+        unsigned tail = c->tail;
+        if (tail == head) {
+            if (!c->running) break;     // woken to stop, nothing left
+            continue;
+        }
+        write_frame(c, tail & (CAPTURE_QUEUE - 1));
+        __atomic_store_n(&c->tail, tail + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+int capture_open(Capture *c, const char *path, int width, int height) {
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    if (width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF) return -1;
+    c->width = width;
+    c->height = height;
+
+    size_t frame = (size_t)width * height * 2;
+    for (int i = 0; i < CAPTURE_QUEUE; i++) {
+        if (!(c->slots[i] = malloc(frame))) goto fail;
+    }
+    c->prev = malloc(frame);
+    c->out = malloc(sizeof(CaptureFrame) + capture_max_size(width * height));
+    if (!c->prev || !c->out) goto fail;
+
+    c->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (c->fd < 0) goto fail;
+    CaptureHeader h = { CAPTURE_MAGIC, CAPTURE_VERSION, 0, (uint16_t)width, (uint16_t)height };
+    if (write_all(c->fd, &h, sizeof(h)) < 0) goto fail;
+
+    if (sem_init(&c->ready, 0, 0) < 0) goto fail;
+    c->running = 1;
+    if (pthread_create(&c->thread, NULL, writer_thread, c) != 0) {
+        c->running = 0;
+        sem_destroy(&c->ready);
+        goto fail;
+    }
+    c->start_us = monotime_us();
+    return 0;
+
+fail:
+    capture_close(c);
+    return -1;
+}
+
+void capture_close(Capture *c) {
+    if (c->running) {
+        c->running = 0;
+        sem_post(&c->ready);
+        pthread_join(c->thread, NULL);
+        sem_destroy(&c->ready);
+    }
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+    for (int i = 0; i < CAPTURE_QUEUE; i++) {
+        free(c->slots[i]);
+        c->slots[i] = NULL;
+    }
+    free(c->prev);
+    free(c->out);
+    c->prev = NULL;
+    c->out = NULL;
+}
+
+int capture_frame(Capture *c, const Canvas *src) {
+    uint32_t seq = c->seq++;
+    unsigned head = c->head;
+    unsigned tail = __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE);
+    if (!c->running || head - tail >= CAPTURE_QUEUE) {
+        c->dropped++;
+        return -1;
+    }
+
+    unsigned slot = head & (CAPTURE_QUEUE - 1);
+    uint8_t *dst = (uint8_t *)c->slots[slot];
+    int row_bytes = c->width * 2;
+    for (int y = 0; y < c->height; y++) {
+        memcpy(dst + y * row_bytes, src->pixels + y * src->stride, row_bytes);
+    }
+    c->slot_seq[slot] = seq;
+    c->slot_t_us[slot] = (uint32_t)(monotime_us() - c->start_us);
+
+    __atomic_store_n(&c->head, head + 1, __ATOMIC_RELEASE);
+    sem_post(&c->ready);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#ifndef TRIMUI_CAPTURE_H
+#define TRIMUI_CAPTURE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "surface.h"
+
+/* Capture stream file format (little-endian, read by tools/capdump.c)
+ *
+ *   CaptureHeader
+ *   then per frame: CaptureFrame, followed by `size` bytes of tokens
+ *
+ * A frame is the XOR of its RGB565 pixels with the previous frame's (with
+ * zero for key frames), run-length coded as 16-bit tokens over all
+ * width * height pixels in row order:
+ *   0nnnnnnn nnnnnnnn   n pixels unchanged (XOR is zero)
+ *   10nnnnnn nnnnnnnn   n XOR values follow, one 16-bit word each
+ *   11nnnnnn nnnnnnnn   one XOR value follows, for the next n pixels
+ * Unchanged areas cost one token, and so does a solid fill (on a key frame)
+ * or an area switching between two solid colours.
+ * A key frame every CAPTURE_KEY_INTERVAL frames keeps a cut-off or partly
+ * corrupted stream decodable from there on.
+ */
+#define CAPTURE_MAGIC         0x50414354u   // "TCAP"
+#define CAPTURE_VERSION       1
+#define CAPTURE_KEY_INTERVAL  60
+#define CAPTURE_QUEUE         4             // snapshots waiting for the writer (power of two)
+#define CAPTURE_KEY_FRAME     0x0001
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint16_t width;
+    uint16_t height;
+} CaptureHeader;
+
+typedef struct {
+    uint32_t seq;       // snapshot number; gaps are frames dropped at capture time
+    uint32_t t_us;      // time since the capture started
+    uint32_t size;      // token bytes that follow
+    uint16_t flags;     // CAPTURE_KEY_FRAME
+    uint16_t reserved;
+} CaptureFrame;
+
+/* Background recorder of presented frames
+ *
+ * capture_frame() only copies the frame into a free queue slot and posts
+ * a semaphore; a writer thread at lower priority computes the delta against
+ * the previous frame, compresses it and writes it out. When the queue is
+ * full (the SD card or the CPU cannot keep up) the frame is dropped rather
+ * than stalling the render loop.
+ */
+typedef struct {
+    int fd;
+    int width, height;
+    uint64_t start_us;
+
+    pthread_t thread;
+    volatile int running;
+    sem_t ready;                        // one post per queued snapshot
+
+    uint16_t *slots[CAPTURE_QUEUE];     // width * height pixels each
+    uint32_t slot_seq[CAPTURE_QUEUE];
+    uint32_t slot_t_us[CAPTURE_QUEUE];
+    unsigned head;          // next slot to fill, owned by capture_frame()
+    unsigned tail;          // next slot to encode, owned by the writer
+    uint32_t seq;
+
+    // Writer thread only
+    uint16_t *prev;         // last frame written
+    uint8_t *out;           // encoded frame
+    int write_failed;
+
+    // Statistics (dropped: by capture_frame, the rest by the writer)
+    uint32_t frames_written;
+    uint32_t dropped;
+    uint64_t raw_bytes;     // what uncompressed frames would have taken
+    uint64_t bytes_written;
+} Capture;
+
+/* Create `path` and start the writer thread; returns 0 or -1 */
+int capture_open(Capture *c, const char *path, int width, int height);
+
+/* Writes out whatever is queued, then stops the thread and closes the file */
+void capture_close(Capture *c);
+
+/* Queue a snapshot of `src` (at least width x height); never blocks
+ * Returns 0, or -1 if the queue was full and the frame was dropped.
+ */
+int capture_frame(Capture *c, const Canvas *src);
+
+/* Encode `cur` against `prev` (NULL = key frame) as tokens into out, which
+ * must hold capture_max_size() bytes; returns the bytes used
+ */
+uint32_t capture_encode(uint8_t *out, const uint16_t *cur, const uint16_t *prev, int n);
+
+static inline uint32_t capture_max_size(int n) {
+    return (uint32_t)n * 2 + ((uint32_t)n / 0x3FFF + 2) * 4;
+}
+
+#endif
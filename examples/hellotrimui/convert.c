@@ -0,0 +1,181 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "convert.h"
+
+// 4x4 Bayer matrix, thresholds 0..15
+static const uint8_t bayer[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 },
+};
+
+/* Per-channel thresholds for one matrix position, each at bit 23 like the
+ * channels in dither_pixel(): 0..7 for 5-bit red and blue, 0..3 for green
+ */
+typedef struct {
+    uint32_t r, g, b;
+} Bias;
+
+static Bias bias_at(int x, int y) {
+    int t = bayer[y & 3][x & 3];
+    return (Bias){ (uint32_t)(t >> 1) << 23, (uint32_t)(t >> 2) << 23, (uint32_t)(t >> 1) << 23 };
+}
+
+/* a + b for a, b < 2^31, saturating at 0x7FFFFFFF
+ * One QADD on ARMv5TE; it needs no compare and leaves the flags alone.
+ */
+static inline uint32_t sat_add(uint32_t a, uint32_t b) {
+#if defined(__ARM_FEATURE_DSP) && !defined(__thumb__)
+    uint32_t r;
+    __asm__("qadd %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+#else
+    uint32_t r = a + b;
+    return r > 0x7FFFFFFFu ? 0x7FFFFFFFu : r;
+#endif
+}
+
+static inline uint16_t pack(uint32_t p) {
+    return (uint16_t)(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F));
+}
+
+/* Each 8-bit channel goes to bits 23..30, gets its threshold added with
+ * saturation, and its top 5 or 6 bits are kept
+ */
+static inline uint16_t dither_pixel(uint32_t p, const Bias *d) {
+    uint32_t r = sat_add((p & 0xFF0000) << 7, d->r);
+    uint32_t g = sat_add((p & 0x00FF00) << 15, d->g);
+    uint32_t b = sat_add((p & 0x0000FF) << 23, d->b);
+    return (uint16_t)((r >> 26 << 11) | (g >> 25 << 5) | (b >> 26));
+}
+
+void convert_init(Converter *c, PixelFormat fmt, int dither) {
+    memset(c, 0, sizeof(*c));
+    c->fmt = fmt;
+    c->dither = dither;
+}
+
+void convert_set_palette(Converter *c, const uint32_t *colors, int count) {
+    int tables = c->dither ? 16 : 1;
+    for (int t = 0; t < tables; t++) {
+        Bias d = bias_at(t & 3, t >> 2);
+        for (int i = 0; i < 256; i++) {
+            uint32_t p = i < count ? colors[i] : 0;
+            c->pal[t][i] = c->dither ? dither_pixel(p, &d) : pack(p);
+        }
+    }
+}
+
+static void span_xrgb(uint16_t *dst, const uint32_t *src, int n) {
+    // Unaligned head pixel, then two pixels per 32-bit store
+    if ((uintptr_t)dst & 2 && n > 0) {
+        *dst++ = pack(*src++);
+        n--;
+    }
+    uint32_t *w = (uint32_t *)dst;
+    for (; n >= 2; n -= 2, src += 2) *w++ = pack(src[0]) | (uint32_t)pack(src[1]) << 16;
+    if (n) *(uint16_t *)w = pack(*src);
+}
+
+static void span_xrgb_dither(uint16_t *dst, const uint32_t *src, int n, int x, int y) {
+    Bias d[4];
+    for (int i = 0; i < 4; i++) d[i] = bias_at(x + i, y);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        dst[i] = dither_pixel(src[i], &d[0]);
+        dst[i + 1] = dither_pixel(src[i + 1], &d[1]);
+        dst[i + 2] = dither_pixel(src[i + 2], &d[2]);
+        dst[i + 3] = dither_pixel(src[i + 3], &d[3]);
+    }
+    for (; i < n; i++) dst[i] = dither_pixel(src[i], &d[i & 3]);
+}
+
+static void span_argb(uint16_t *dst, const uint32_t *src, int n, int dither, int x, int y) {
+    Bias d[4];
+    if (dither) {
+        for (int i = 0; i < 4; i++) d[i] = bias_at(x + i, y);
+    }
+    for (int i = 0; i < n; i++) {
+        uint32_t p = src[i];
+        if (!(p & 0x80000000u)) continue;
+        dst[i] = dither ? dither_pixel(p, &d[i & 3]) : pack(p);
+    }
+}
+
+static inline uint16_t swap_rb(uint16_t c) {
+    return (uint16_t)((c >> 11) | (c & 0x07E0) | (c << 11));
+}
+
+static void span_bgr565(uint16_t *dst, const uint16_t *src, int n) {
+    if ((uintptr_t)dst & 2 && n > 0) {
+        *dst++ = swap_rb(*src++);
+        n--;
+    }
+    if (!((uintptr_t)src & 2)) {
+        // Both aligned: swap red and blue of two pixels at once
+        uint32_t *w = (uint32_t *)dst;
+        const uint32_t *s = (const uint32_t *)src;
+        for (; n >= 2; n -= 2) {
+            uint32_t v = *s++;
+            *w++ = ((v >> 11) & 0x001F001Fu) | (v & 0x07E007E0u) | ((v << 11) & 0xF800F800u);
+        }
+        dst = (uint16_t *)w;
+        src = (const uint16_t *)s;
+    }
+    while (n-- > 0) *dst++ = swap_rb(*src++);
+}
+
+static void span_pal8(uint16_t *dst, const uint8_t *src, int n, const uint16_t *const t[4]) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        dst[i] = t[0][src[i]];
+        dst[i + 1] = t[1][src[i + 1]];
+        dst[i + 2] = t[2][src[i + 2]];
+        dst[i + 3] = t[3][src[i + 3]];
+    }
+    for (; i < n; i++) dst[i] = t[i & 3][src[i]];
+}
+
+void convert_span(const Converter *c, uint16_t *dst, const void *src, int n, int x, int y) {
+    if (n <= 0) return;
+    switch (c->fmt) {
+    case PIXFMT_XRGB8888:
+        if (c->dither) span_xrgb_dither(dst, src, n, x, y);
+        else span_xrgb(dst, src, n);
+        break;
+    case PIXFMT_ARGB8888:
+        span_argb(dst, src, n, c->dither, x, y);
+        break;
+    case PIXFMT_BGR565:
+        span_bgr565(dst, src, n);
+        break;
+    case PIXFMT_PAL8: {
+        // Tables in the order of the dither phases dst[0..3] fall on
+        const uint16_t *t[4];
+        for (int i = 0; i < 4; i++) t[i] = c->dither ? c->pal[(y & 3) * 4 + ((x + i) & 3)] : c->pal[0];
+        span_pal8(dst, src, n, t);
+        break;
+    }
+    }
+}
+
+void convert_blit(const Converter *c, Canvas *dst, int dx, int dy,
+                  const void *src, int src_stride, int w, int h) {
+    static const int bytes[] = { 4, 4, 2, 1 };
+    int bpp = bytes[c->fmt];
+    const uint8_t *s = src;
+
+    // Clip against the canvas, moving the source origin along
+    if (dx < 0) { s -= dx * bpp; w += dx; dx = 0; }
+    if (dy < 0) { s -= (ptrdiff_t)dy * src_stride; h += dy; dy = 0; }
+    if (dx + w > dst->width) w = dst->width - dx;
+    if (dy + h > dst->height) h = dst->height - dy;
+    if (w <= 0 || h <= 0) return;
+
+    uint8_t *line = dst->pixels + dy * dst->stride + dx * 2;
+    for (int y = 0; y < h; y++, line += dst->stride, s += src_stride) {
+        convert_span(c, (uint16_t *)line, s, w, dx, dy + y);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef TRIMUI_CONVERT_H
+#define TRIMUI_CONVERT_H
+
+#include <stdint.h>
+
+#include "surface.h"
+
+/* Source pixel formats, in native byte order */
+typedef enum {
+    PIXFMT_XRGB8888 = 0,    // 32-bit 0xXXRRGGBB
+    PIXFMT_ARGB8888,        // 32-bit 0xAARRGGBB; alpha below 0x80 leaves dst untouched
+    PIXFMT_BGR565,          // 16-bit BBBBBGGGGGGRRRRR
+    PIXFMT_PAL8,            // 8-bit index into convert_set_palette()
+} PixelFormat;
+
+/* Converter from one source format to RGB565 (RRRRRGGGGGGBBBBB)
+ *
+ * Dropping 8-bit channels to 5 and 6 bits bands smooth gradients; with
+ * dithering on, a 4x4 ordered (Bayer) threshold is added to each channel
+ * before it is truncated. The threshold depends on the destination pixel's
+ * screen position, so the pattern stays put when content scrolls.
+ *
+ * Palettised sources are a table lookup per pixel: the palette is converted
+ * once into 256-entry RGB565 tables, 16 of them (one per dither position)
+ * when dithering, so dithered indexed content costs no more than plain.
+ */
+typedef struct {
+    PixelFormat fmt;
+    int dither;
+    uint16_t pal[16][256];  // PAL8: [(y & 3) * 4 + (x & 3)], only [0] without dithering
+} Converter;
+
+void convert_init(Converter *c, PixelFormat fmt, int dither);
+
+/* PAL8: `count` colours as 0xXXRRGGBB; missing entries become black */
+void convert_set_palette(Converter *c, const uint32_t *colors, int count);
+
+/* Convert `n` pixels into dst (no clipping); (x, y) is the screen position
+ * of dst[0], which picks the dither phase
+ */
+void convert_span(const Converter *c, uint16_t *dst, const void *src, int n, int x, int y);
+
+/* Convert a w x h source image with rows `src_stride` bytes apart to (dx, dy)
+ * on the canvas, clipped
+ */
+void convert_blit(const Converter *c, Canvas *dst, int dx, int dy,
+                  const void *src, int src_stride, int w, int h);
+
+#endif
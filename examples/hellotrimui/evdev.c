@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/inotify.h>
+
+#include "evdev.h"
+
+#define INPUT_DIR "/dev/input"
+
+/* Parse N out of "eventN"; returns -1 for anything else */
+static int event_index(const char *name) {
+    if (strncmp(name, "event", 5) != 0 || name[5] < '0' || name[5] > '9') return -1;
+    return atoi(name + 5);
+}
+
+static EvdevDevice *find_index(EvdevManager *m, int index) {
+    for (int i = 0; i < m->num_devices; i++) {
+        if (m->devices[i].index == index) return &m->devices[i];
+    }
+    return NULL;
+}
+
+/* True if the device reports at least one wanted key code */
+static int has_wanted_keys(EvdevManager *m, int fd) {
+    uint8_t evbits[(EV_MAX + 8) / 8];
+    uint8_t keybits[(KEY_MAX + 8) / 8];
+    memset(evbits, 0, sizeof(evbits));
+    memset(keybits, 0, sizeof(keybits));
+
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(evbits)), evbits) < 0) return 0;
+    if (!(evbits[EV_KEY / 8] & (1 << (EV_KEY % 8)))) return 0;
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits) < 0) return 0;
+
+    for (int code = 0; code < KEY_CNT; code++) {
+        if ((m->wanted[code / 32] >> (code % 32)) & 1 &&
+            keybits[code / 8] & (1 << (code % 8))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Open /dev/input/eventN if it is a device we want and not open already */
+static void open_device(EvdevManager *m, int index) {
+    if (index < 0 || find_index(m, index) || m->num_devices == EVDEV_MAX_DEVICES) return;
+
+    char path[64];
+    snprintf(path, sizeof(path), INPUT_DIR "/event%d", index);
+    // O_NONBLOCK ensures read() returns immediately if no data available
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return;   // e.g. EACCES until udev fixes permissions: IN_ATTRIB retries
+
+    if (!has_wanted_keys(m, fd)) {
+        close(fd);
+        return;
+    }
+
+    // Stamp events with CLOCK_MONOTONIC so they compare with monotime_us()
+    #ifdef EVIOCSCLOCKID
+    int clk = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clk) < 0) m->monotonic = 0;
+    #else
+    m->monotonic = 0;
+    #endif
+
+    if (m->grab) ioctl(fd, EVIOCGRAB, 1);
+
+    EvdevDevice *d = &m->devices[m->num_devices++];
+    d->fd = fd;
+    d->index = index;
+    if (ioctl(fd, EVIOCGNAME(sizeof(d->name)), d->name) < 0) d->name[0] = '\0';
+    d->name[sizeof(d->name) - 1] = '\0';
+
+    if (m->on_device) m->on_device(fd, 1, m->user);
+}
+
+static void close_device(EvdevManager *m, EvdevDevice *d) {
+    if (m->on_device) m->on_device(d->fd, 0, m->user);
+    close(d->fd);
+    *d = m->devices[--m->num_devices];
+}
+
+int evdev_init(EvdevManager *m, const int *codes, int num_codes, int grab,
+               EvdevEventsFn on_events, EvdevDeviceFn on_device, void *user) {
+    memset(m, 0, sizeof(*m));
+    for (int i = 0; i < num_codes; i++) {
+        if (codes[i] >= 0 && codes[i] < KEY_CNT) {
+            m->wanted[codes[i] / 32] |= 1u << (codes[i] % 32);
+        }
+    }
+    m->grab = grab;
+    m->monotonic = 1;
+    m->on_events = on_events;
+    m->on_device = on_device;
+    m->user = user;
+
+    // Hotplug: nodes appear/disappear in /dev/input, permissions may follow later
+    m->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m->inotify_fd >= 0 &&
+        inotify_add_watch(m->inotify_fd, INPUT_DIR, IN_CREATE | IN_DELETE | IN_ATTRIB) < 0) {
+        close(m->inotify_fd);
+        m->inotify_fd = -1;
+    }
+    return 0;
+}
+
+int evdev_scan(EvdevManager *m) {
+    DIR *dir = opendir(INPUT_DIR);
+    if (!dir) return m->num_devices;
+
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        open_device(m, event_index(de->d_name));
+    }
+    closedir(dir);
+    return m->num_devices;
+}
+
+void evdev_free(EvdevManager *m) {
+    while (m->num_devices > 0) close_device(m, &m->devices[m->num_devices - 1]);
+    if (m->inotify_fd >= 0) close(m->inotify_fd);
+    m->inotify_fd = -1;
+}
+
+void evdev_on_readable(int fd, void *user) {
+    EvdevManager *m = user;
+    struct input_event buf[EVDEV_BATCH];
+
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENODEV) {
+                // Unplugged: inotify may not have told us yet
+                for (int i = 0; i < m->num_devices; i++) {
+                    if (m->devices[i].fd == fd) {
+                        close_device(m, &m->devices[i]);
+                        break;
+                    }
+                }
+            }
+            return;
+        }
+
+        int count = (int)(n / sizeof(buf[0]));
+        if (count > 0 && m->on_events) m->on_events(buf, count, m->user);
+
+        // A short read means the kernel queue is drained
+        if (n < (ssize_t)sizeof(buf)) return;
+    }
+}
+
+void evdev_on_hotplug(int fd, void *user) {
+    EvdevManager *m = user;
+    // Aligned for struct inotify_event, big enough for several events
+    char buf[1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            struct inotify_event *ie = (struct inotify_event *)p;
+            p += sizeof(*ie) + ie->len;
+
+            int index = ie->len ? event_index(ie->name) : -1;
+            if (index < 0) continue;
+
+            if (ie->mask & IN_DELETE) {
+                EvdevDevice *d = find_index(m, index);
+                if (d) close_device(m, d);
+            } else {
+                open_device(m, index);
+            }
+        }
+    }
+}
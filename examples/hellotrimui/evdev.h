@@ -0,0 +1,59 @@
+#ifndef TRIMUI_EVDEV_H
+#define TRIMUI_EVDEV_H
+
+#include <linux/input.h>
+
+#define EVDEV_MAX_DEVICES 16
+#define EVDEV_BATCH       64    // events pulled per read()
+#define EVDEV_KEY_WORDS   ((KEY_CNT + 31) / 32)
+
+typedef struct {
+    int fd;
+    int index;          // N in /dev/input/eventN
+    char name[64];      // EVIOCGNAME
+} EvdevDevice;
+
+/* Batch of events read from one device */
+typedef void (*EvdevEventsFn)(const struct input_event *ev, int count, void *user);
+/* A device fd was opened (added = 1) or is about to be closed (added = 0) */
+typedef void (*EvdevDeviceFn)(int fd, int added, void *user);
+
+/* Input device manager
+ *
+ * Opens only the /dev/input/event* nodes whose EV_KEY capabilities include
+ * at least one of the wanted key codes, so power keys, accelerometers and
+ * other noisy devices never wake the loop. Devices plugged in or removed
+ * later are picked up through inotify on /dev/input.
+ *
+ * evdev_on_readable() and evdev_on_hotplug() have the RunLoopFdFn signature
+ * and can be registered with the run loop directly (user = the manager).
+ */
+typedef struct {
+    EvdevDevice devices[EVDEV_MAX_DEVICES];
+    int num_devices;
+
+    uint32_t wanted[EVDEV_KEY_WORDS];   // bitset of key codes we care about
+    int grab;               // take EVIOCGRAB on every device we open
+    int monotonic;          // all devices stamp events with CLOCK_MONOTONIC
+    int inotify_fd;         // -1 if hotplug is unavailable
+
+    EvdevEventsFn on_events;
+    EvdevDeviceFn on_device;
+    void *user;
+} EvdevManager;
+
+/* Set up the manager for the given key codes; does not open anything yet */
+int evdev_init(EvdevManager *m, const int *codes, int num_codes, int grab,
+               EvdevEventsFn on_events, EvdevDeviceFn on_device, void *user);
+
+/* Open every matching device currently present; returns how many are open */
+int evdev_scan(EvdevManager *m);
+
+/* Close all devices and the inotify watch */
+void evdev_free(EvdevManager *m);
+
+/* Read callbacks for the run loop */
+void evdev_on_readable(int fd, void *user);
+void evdev_on_hotplug(int fd, void *user);
+
+#endif
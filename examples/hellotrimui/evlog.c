@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "evlog.h"
+#include "monotime.h"
+
+/* Time left after the last event so its effects reach the screen */
+#define EVLOG_TAIL_US 200000
+
+int evlog_writer_open(EvlogWriter *w, const char *path) {
+    w->start_us = 0;
+    w->f = fopen(path, "w");
+    if (!w->f) return -1;
+    fprintf(w->f, "# t_us type code value\n");
+    return 0;
+}
+
+void evlog_write(EvlogWriter *w, const struct input_event *ev, int count) {
+    if (!w->f) return;
+    for (int i = 0; i < count; i++) {
+        uint64_t t = timeval_us(&ev[i].time);
+        if (!w->start_us) w->start_us = t;
+        fprintf(w->f, "%llu %u %u %d\n", (unsigned long long)(t - w->start_us),
+                ev[i].type, ev[i].code, ev[i].value);
+    }
+}
+
+void evlog_writer_close(EvlogWriter *w) {
+    if (w->f) fclose(w->f);
+    w->f = NULL;
+}
+
+int evlog_reader_open(EvlogReader *r, const char *path,
+                      EvdevEventsFn on_events, EvlogDoneFn on_done, void *user) {
+    memset(r, 0, sizeof(*r));
+    r->on_events = on_events;
+    r->on_done = on_done;
+    r->user = user;
+
+    r->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (r->timer_fd < 0) return -1;
+    if (!path) return 0;
+
+    FILE *f = fopen(path, "r");
+    if (!f) goto fail;
+
+    int cap = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long t;
+        unsigned type, code;
+        int value;
+        if (line[0] == '#' || sscanf(line, "%llu %u %u %d", &t, &type, &code, &value) != 4) continue;
+
+        if (r->count == cap) {
+            cap = cap ? cap * 2 : 256;
+            struct input_event *ev = realloc(r->events, cap * sizeof(*ev));
+            uint32_t *ts = realloc(r->t_us, cap * sizeof(*ts));
+            if (ev) r->events = ev;
+            if (ts) r->t_us = ts;
+            if (!ev || !ts) {
+                fclose(f);
+                goto fail;
+            }
+        }
+        memset(&r->events[r->count], 0, sizeof(r->events[0]));
+        r->events[r->count].type = (uint16_t)type;
+        r->events[r->count].code = (uint16_t)code;
+        r->events[r->count].value = value;
+        r->t_us[r->count] = (uint32_t)t;
+        r->count++;
+    }
+    fclose(f);
+    return 0;
+
+fail:
+    evlog_reader_close(r);
+    return -1;
+}
+
+/* Arm the timer for the next event, or for the end of the replay */
+static void arm(EvlogReader *r) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    uint64_t due = r->start_us;
+    if (r->next < r->count) due += r->t_us[r->next];
+    else if (r->count > 0) due += r->t_us[r->count - 1] + EVLOG_TAIL_US;
+    its.it_value.tv_sec = due / 1000000u;
+    its.it_value.tv_nsec = (due % 1000000u) * 1000;
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) its.it_value.tv_nsec = 1;
+    timerfd_settime(r->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+void evlog_reader_start(EvlogReader *r) {
+    r->next = 0;
+    r->draining = 0;
+    r->start_us = monotime_us();
+    arm(r);
+}
+
+void evlog_reader_close(EvlogReader *r) {
+    free(r->events);
+    free(r->t_us);
+    r->events = NULL;
+    r->t_us = NULL;
+    r->count = 0;
+    if (r->timer_fd >= 0) close(r->timer_fd);
+    r->timer_fd = -1;
+}
+
+void evlog_on_timer(int fd, void *user) {
+    EvlogReader *r = user;
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) < 0) return;
+
+    // Deliver everything that is due, in batches like a real evdev read()
+    uint64_t now = monotime_us() - r->start_us;
+    while (r->next < r->count && r->t_us[r->next] <= now) {
+        int first = r->next;
+        while (r->next < r->count && r->t_us[r->next] <= now &&
+               r->next - first < EVDEV_BATCH) {
+            uint64_t t = r->start_us + r->t_us[r->next];
+            r->events[r->next].time.tv_sec = t / 1000000u;
+            r->events[r->next].time.tv_usec = t % 1000000u;
+            r->next++;
+        }
+        if (r->on_events) r->on_events(&r->events[first], r->next - first, r->user);
+    }
+
+    if (r->next < r->count || !r->draining) {
+        r->draining = r->next == r->count;
+        arm(r);
+    } else if (r->on_done) {
+        EvlogDoneFn done = r->on_done;
+        r->on_done = NULL;
+        done(r->user);
+    }
+}
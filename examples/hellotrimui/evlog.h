@@ -0,0 +1,56 @@
+#ifndef TRIMUI_EVLOG_H
+#define TRIMUI_EVLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <linux/input.h>
+
+#include "evdev.h"
+
+/* Recorded input event logs
+ *
+ * One event per line, times relative to the first recorded event:
+ *   <t_us> <type> <code> <value>
+ * '#' starts a comment, so logs can be written or annotated by hand.
+ */
+
+typedef struct {
+    FILE *f;
+    uint64_t start_us;      // ev.time of the first event, 0 = none yet
+} EvlogWriter;
+
+int evlog_writer_open(EvlogWriter *w, const char *path);
+void evlog_write(EvlogWriter *w, const struct input_event *ev, int count);
+void evlog_writer_close(EvlogWriter *w);
+
+typedef void (*EvlogDoneFn)(void *user);
+
+/* Replays a log in real time through a timerfd
+ * Events are delivered in batches with ev.time rebased onto CLOCK_MONOTONIC,
+ * exactly as the evdev manager would deliver them. evlog_on_timer() has the
+ * RunLoopFdFn signature (user = the reader); register it for `timer_fd`.
+ */
+typedef struct {
+    struct input_event *events;
+    uint32_t *t_us;             // per event, relative to the start of the replay
+    int count;
+    int next;
+    int draining;               // all events delivered, waiting out the tail
+    uint64_t start_us;          // monotonic time the replay started
+    int timer_fd;
+
+    EvdevEventsFn on_events;
+    EvlogDoneFn on_done;        // called once after the last event
+    void *user;
+} EvlogReader;
+
+/* Load a log; a NULL path replays an empty log (on_done fires right away) */
+int evlog_reader_open(EvlogReader *r, const char *path,
+                      EvdevEventsFn on_events, EvlogDoneFn on_done, void *user);
+/* Start the clock and arm the timer for the first event */
+void evlog_reader_start(EvlogReader *r);
+void evlog_reader_close(EvlogReader *r);
+
+void evlog_on_timer(int fd, void *user);
+
+#endif
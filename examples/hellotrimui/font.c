@@ -0,0 +1,448 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "font.h"
+
+#define PSF2_MAGIC      0x864AB572u
+#define PSF2_HAS_TABLE  0x01
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t flags;
+    uint32_t length;        // number of glyphs
+    uint32_t glyph_bytes;
+    uint32_t height;
+    uint32_t width;
+} Psf2Header;
+
+uint32_t utf8_next(const char **s) {
+    const uint8_t *p = (const uint8_t *)*s;
+    uint32_t c = p[0];
+    int n = c < 0x80 ? 0 : c < 0xC2 ? -1 : c < 0xE0 ? 1 : c < 0xF0 ? 2 : c < 0xF5 ? 3 : -1;
+    if (n < 0) {
+        *s += 1;
+        return FONT_REPLACEMENT;
+    }
+    if (n > 0) c &= 0x3F >> n;
+
+    // A missing continuation byte (including the terminating NUL) ends the sequence
+    for (int i = 1; i <= n; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            *s += i;
+            return FONT_REPLACEMENT;
+        }
+        c = (c << 6) | (p[i] & 0x3F);
+    }
+    *s += n + 1;
+
+    if ((n == 2 && c < 0x800) || (n == 3 && (c < 0x10000 || c > 0x10FFFF)) ||
+        (c >= 0xD800 && c <= 0xDFFF)) {
+        return FONT_REPLACEMENT;
+    }
+    return c;
+}
+
+/* ---- Code point index ---- */
+
+static int index_add(Font *f, uint32_t *cap, uint32_t cp, uint32_t ref) {
+    if (f->index_count == *cap) {
+        *cap = *cap ? *cap * 2 : 256;
+        FontIndexEntry *grown = realloc(f->index, *cap * sizeof(*grown));
+        if (!grown) return -1;
+        f->index = grown;
+    }
+    f->index[f->index_count].cp = cp;
+    f->index[f->index_count].ref = ref;
+    f->index_count++;
+    return 0;
+}
+
+static int cmp_entry(const void *a, const void *b) {
+    const FontIndexEntry *x = a, *y = b;
+    if (x->cp != y->cp) return x->cp < y->cp ? -1 : 1;
+    return x->ref < y->ref ? -1 : x->ref > y->ref;
+}
+
+/* Sort the index and drop duplicate code points (the first glyph wins) */
+static void index_finish(Font *f) {
+    if (!f->index_count) return;
+    qsort(f->index, f->index_count, sizeof(f->index[0]), cmp_entry);
+    uint32_t n = 1;
+    for (uint32_t i = 1; i < f->index_count; i++) {
+        if (f->index[i].cp != f->index[n - 1].cp) f->index[n++] = f->index[i];
+    }
+    f->index_count = n;
+    FontIndexEntry *shrunk = realloc(f->index, n * sizeof(f->index[0]));
+    if (shrunk) f->index = shrunk;
+}
+
+/* Glyph reference for a code point; returns 0 if the font has none */
+static int font_lookup(const Font *f, uint32_t cp, uint32_t *ref) {
+    if (!f->index) {
+        if (f->format != FONT_PSF2 || cp >= f->glyph_count) return 0;
+        *ref = cp;
+        return 1;
+    }
+    uint32_t lo = 0, hi = f->index_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (f->index[mid].cp < cp) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == f->index_count || f->index[lo].cp != cp) return 0;
+    *ref = f->index[lo].ref;
+    return 1;
+}
+
+/* ---- PSF2 ---- */
+
+static int open_psf2(Font *f) {
+    Psf2Header h;
+    memcpy(&h, f->data, sizeof(h));
+    if (h.header_size < sizeof(h) || h.header_size > f->size || h.length == 0 ||
+        h.width == 0 || h.height == 0 || h.width > FONT_MAX_CELL || h.height > FONT_MAX_CELL ||
+        h.glyph_bytes < (h.width + 7) / 8 * h.height ||
+        (uint64_t)h.length * h.glyph_bytes > f->size - h.header_size) {
+        return -1;
+    }
+    f->format = FONT_PSF2;
+    f->glyphs = f->data + h.header_size;
+    f->glyph_count = h.length;
+    f->glyph_bytes = h.glyph_bytes;
+    f->width = h.width;
+    f->height = h.height;
+    f->ascent = h.height;
+    f->max_width = h.width;
+    if (!(h.flags & PSF2_HAS_TABLE)) return 0;
+
+    // Unicode table: per glyph, UTF-8 code points, then optional 0xFE-prefixed
+    // combining sequences (not used here), terminated by 0xFF
+    uint32_t cap = 0;
+    const uint8_t *p = f->glyphs + (size_t)h.length * h.glyph_bytes;
+    const uint8_t *end = f->data + f->size;
+    for (uint32_t g = 0; g < h.length && p < end; g++) {
+        int in_sequence = 0;
+        while (p < end && *p != 0xFF) {
+            if (*p == 0xFE) {
+                in_sequence = 1;
+                p++;
+                continue;
+            }
+            // Decode from a small NUL-terminated copy so we never read past the map
+            char buf[5] = { 0 };
+            for (int i = 0; i < 4 && p + i < end && p[i] != 0xFF && p[i] != 0xFE; i++) buf[i] = p[i];
+            const char *s = buf;
+            uint32_t cp = utf8_next(&s);
+            p += s - buf;
+            if (!in_sequence && index_add(f, &cap, cp, g) < 0) return -1;
+        }
+        p++;
+    }
+    index_finish(f);
+    return 0;
+}
+
+/* ---- BDF ---- */
+
+/* Copy the line at p into buf (NUL-terminated); returns the start of the next line */
+static const uint8_t *read_line(const uint8_t *p, const uint8_t *end, char *buf, int len) {
+    int n = 0;
+    while (p < end && *p != '\n') {
+        if (n < len - 1) buf[n++] = (char)*p;
+        p++;
+    }
+    buf[n] = '\0';
+    return p < end ? p + 1 : end;
+}
+
+static int keyword(const char *line, const char *kw) {
+    size_t n = strlen(kw);
+    return strncmp(line, kw, n) == 0 && (line[n] == ' ' || line[n] == '\0' || line[n] == '\r');
+}
+
+static int open_bdf(Font *f) {
+    const uint8_t *p = f->data, *end = f->data + f->size;
+    char line[128];
+    int ascent = -1, descent = -1;
+    uint32_t cap = 0, char_off = 0;
+    f->format = FONT_BDF;
+
+    while (p < end) {
+        uint32_t off = (uint32_t)(p - f->data);
+        p = read_line(p, end, line, sizeof(line));
+        int a, b;
+        if (keyword(line, "FONTBOUNDINGBOX")) {
+            sscanf(line + 15, "%d %d %d %d", &f->bbx_w, &f->bbx_h, &f->bbx_x, &f->bbx_y);
+        } else if (keyword(line, "FONT_ASCENT")) {
+            ascent = atoi(line + 11);
+        } else if (keyword(line, "FONT_DESCENT")) {
+            descent = atoi(line + 12);
+        } else if (keyword(line, "STARTCHAR")) {
+            char_off = off;
+        } else if (keyword(line, "ENCODING")) {
+            int cp = atoi(line + 8);
+            if (cp >= 0 && index_add(f, &cap, (uint32_t)cp, char_off) < 0) return -1;
+        } else if (keyword(line, "DWIDTH") && sscanf(line + 6, "%d %d", &a, &b) >= 1) {
+            if (a > f->max_width) f->max_width = a;
+        }
+    }
+
+    if (ascent < 0) ascent = f->bbx_h + f->bbx_y;
+    if (descent < 0) descent = -f->bbx_y;
+    f->ascent = ascent;
+    f->height = ascent + descent;
+    if (f->max_width <= 0) f->max_width = f->bbx_w;
+    if (f->max_width > FONT_MAX_CELL) f->max_width = FONT_MAX_CELL;
+    if (f->height <= 0 || f->height > FONT_MAX_CELL || f->max_width <= 0 || !f->index_count) {
+        return -1;
+    }
+    index_finish(f);
+    return 0;
+}
+
+int font_open_memory(Font *f, const void *data, size_t size) {
+    memset(f, 0, sizeof(*f));
+    f->data = data;
+    f->size = size;
+
+    uint32_t magic = 0;
+    if (size >= sizeof(Psf2Header)) memcpy(&magic, data, 4);
+    int ret;
+    if (magic == PSF2_MAGIC) ret = open_psf2(f);
+    else if (size >= 9 && memcmp(data, "STARTFONT", 9) == 0) ret = open_bdf(f);
+    else ret = -1;
+
+    if (ret < 0) {
+        free(f->index);
+        f->index = NULL;
+    }
+    return ret;
+}
+
+int font_open(Font *f, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    if (font_open_memory(f, map, st.st_size) < 0) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    f->mapped = 1;
+    return 0;
+}
+
+void font_close(Font *f) {
+    if (f->mapped) munmap((void *)f->data, f->size);
+    free(f->index);
+    memset(f, 0, sizeof(*f));
+}
+
+/* ---- Rasterising ---- */
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+/* Draw glyph `ref` into a cell of font->height rows, `stride` pixels apart
+ * The cell is already filled with the background. Returns the advance.
+ */
+static int rasterise(const Font *f, uint32_t ref, uint16_t *cell, int stride, uint16_t fg) {
+    if (f->format == FONT_PSF2) {
+        const uint8_t *bits = f->glyphs + (size_t)ref * f->glyph_bytes;
+        int row_bytes = (f->width + 7) / 8;
+        for (int y = 0; y < f->height; y++, bits += row_bytes) {
+            for (int x = 0; x < f->width; x++) {
+                if (bits[x >> 3] & (0x80 >> (x & 7))) cell[y * stride + x] = fg;
+            }
+        }
+        return f->width;
+    }
+
+    // BDF: walk the glyph's lines from STARTCHAR to ENDCHAR
+    const uint8_t *p = f->data + ref, *end = f->data + f->size;
+    char line[128];
+    int advance = f->bbx_w, w = 0, h = 0, xo = 0, yo = 0;
+    while (p < end) {
+        p = read_line(p, end, line, sizeof(line));
+        if (keyword(line, "DWIDTH")) {
+            advance = atoi(line + 6);
+        } else if (keyword(line, "BBX")) {
+            sscanf(line + 3, "%d %d %d %d", &w, &h, &xo, &yo);
+        } else if (keyword(line, "BITMAP")) {
+            if (advance > f->max_width) advance = f->max_width;
+            int top = f->ascent - (yo + h);
+            for (int r = 0; r < h && p < end; r++) {
+                p = read_line(p, end, line, sizeof(line));
+                int y = top + r;
+                if (y < 0 || y >= f->height) continue;
+                for (int x = 0; x < w && line[x >> 2]; x++) {
+                    int px = xo + x;
+                    if (px < 0 || px >= advance) continue;
+                    if (hex_digit(line[x >> 2]) & (8 >> (x & 3))) cell[y * stride + px] = fg;
+                }
+            }
+            break;
+        } else if (keyword(line, "ENDCHAR")) {
+            break;
+        }
+    }
+    return advance > 0 ? advance : 0;
+}
+
+/* ---- Cache ---- */
+
+int font_cache_init(FontCache *c, const Font *f, int num_slots, uint16_t fg, uint16_t bg) {
+    memset(c, 0, sizeof(*c));
+    if (num_slots < 1 || num_slots > 0x7FFF) return -1;
+    c->font = f;
+    c->fg = fg;
+    c->bg = bg;
+    c->num_slots = num_slots;
+    c->mru = c->lru = -1;
+
+    c->num_buckets = 1;
+    while (c->num_buckets < 2 * num_slots) c->num_buckets <<= 1;
+
+    c->slots = calloc(num_slots, sizeof(*c->slots));
+    c->buckets = malloc(c->num_buckets * sizeof(*c->buckets));
+    c->pixels = malloc((size_t)num_slots * f->height * f->max_width * sizeof(uint16_t));
+    if (!c->slots || !c->buckets || !c->pixels) {
+        font_cache_free(c);
+        return -1;
+    }
+    memset(c->buckets, 0xFF, c->num_buckets * sizeof(*c->buckets));
+    return 0;
+}
+
+void font_cache_free(FontCache *c) {
+    free(c->slots);
+    free(c->buckets);
+    free(c->pixels);
+    c->slots = NULL;
+    c->buckets = NULL;
+    c->pixels = NULL;
+}
+
+static int bucket_of(const FontCache *c, uint32_t cp) {
+    return (int)((cp * 2654435761u) >> 16) & (c->num_buckets - 1);
+}
+
+static uint16_t *cell_of(const FontCache *c, int slot) {
+    return c->pixels + (size_t)slot * c->font->height * c->font->max_width;
+}
+
+static void lru_unlink(FontCache *c, int s) {
+    FontCacheSlot *e = &c->slots[s];
+    if (e->prev >= 0) c->slots[e->prev].next = e->next; else c->mru = e->next;
+    if (e->next >= 0) c->slots[e->next].prev = e->prev; else c->lru = e->prev;
+}
+
+static void lru_push(FontCache *c, int s) {
+    FontCacheSlot *e = &c->slots[s];
+    e->prev = -1;
+    e->next = c->mru;
+    if (c->mru >= 0) c->slots[c->mru].prev = (int16_t)s;
+    c->mru = (int16_t)s;
+    if (c->lru < 0) c->lru = (int16_t)s;
+}
+
+/* Slot holding `cp`, rasterising it (and evicting the LRU glyph) on a miss */
+static int cache_get(FontCache *c, uint32_t cp) {
+    int b = bucket_of(c, cp);
+    for (int s = c->buckets[b]; s >= 0; s = c->slots[s].chain) {
+        if (c->slots[s].cp == cp) {
+            c->hits++;
+            if (c->mru != s) {
+                lru_unlink(c, s);
+                lru_push(c, s);
+            }
+            return s;
+        }
+    }
+    c->misses++;
+
+    int s;
+    if (c->used < c->num_slots) {
+        s = c->used++;
+    } else {
+        s = c->lru;
+        lru_unlink(c, s);
+        int16_t *link = &c->buckets[bucket_of(c, c->slots[s].cp)];
+        while (*link != s) link = &c->slots[*link].chain;
+        *link = c->slots[s].chain;
+        c->evictions++;
+    }
+
+    const Font *f = c->font;
+    uint16_t *cell = cell_of(c, s);
+    for (int i = 0; i < f->height * f->max_width; i++) cell[i] = c->bg;
+
+    // Missing glyphs are cached under their own code point as well
+    uint32_t ref;
+    int advance;
+    if (font_lookup(f, cp, &ref) || font_lookup(f, FONT_REPLACEMENT, &ref) ||
+        font_lookup(f, '?', &ref)) {
+        advance = rasterise(f, ref, cell, f->max_width, c->fg);
+    } else {
+        advance = f->max_width / 2;
+    }
+
+    FontCacheSlot *e = &c->slots[s];
+    e->cp = cp;
+    e->advance = (int16_t)advance;
+    e->chain = c->buckets[b];
+    c->buckets[b] = (int16_t)s;
+    lru_push(c, s);
+    return s;
+}
+
+int font_draw_text(Canvas *dst, int x, int y, const char *utf8, FontCache *c) {
+    const Font *f = c->font;
+    int r0 = y < 0 ? -y : 0;
+    int r1 = y + f->height > dst->height ? dst->height - y : f->height;
+
+    while (*utf8) {
+        int s = cache_get(c, utf8_next(&utf8));
+        int w = c->slots[s].advance;
+
+        // Clip the cell once, then one memcpy per row
+        int c0 = x < 0 ? -x : 0;
+        int c1 = x + w > dst->width ? dst->width - x : w;
+        if (c0 < c1 && r0 < r1) {
+            const uint16_t *src = cell_of(c, s) + r0 * f->max_width + c0;
+            uint8_t *line = dst->pixels + (y + r0) * dst->stride + (x + c0) * 2;
+            for (int r = r0; r < r1; r++) {
+                memcpy(line, src, (c1 - c0) * sizeof(uint16_t));
+                src += f->max_width;
+                line += dst->stride;
+            }
+        }
+        x += w;
+        if (x >= dst->width) break;
+    }
+    return x;
+}
+
+int font_text_width(FontCache *c, const char *utf8) {
+    int w = 0;
+    while (*utf8) w += c->slots[cache_get(c, utf8_next(&utf8))].advance;
+    return w;
+}
@@ -0,0 +1,105 @@
+#ifndef TRIMUI_FONT_H
+#define TRIMUI_FONT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "surface.h"
+
+#define FONT_MAX_CELL     64        // largest glyph width or height we rasterise
+#define FONT_REPLACEMENT  0xFFFD    // drawn for code points the font lacks (or '?')
+
+typedef enum {
+    FONT_PSF2 = 0,
+    FONT_BDF,
+} FontFormat;
+
+/* Code point → glyph, sorted by code point */
+typedef struct {
+    uint32_t cp;
+    uint32_t ref;       // PSF2: glyph number; BDF: offset of its STARTCHAR line
+} FontIndexEntry;
+
+/* A bitmap font used in place
+ *
+ * The file is mmap'd (or borrowed, e.g. a raw asset in a pack) and never
+ * copied: opening only builds the code point index, 8 bytes per glyph, so
+ * a large CJK font costs its index in RAM and the pages actually touched.
+ * PSF2 fonts are fixed width; BDF fonts are proportional (DWIDTH).
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    int mapped;             // data is our mmap and is unmapped on close
+    FontFormat format;
+
+    int height;             // line height in pixels
+    int ascent;             // baseline, pixels below the top of the line
+    int max_width;          // widest advance (cache cell width)
+
+    // PSF2
+    const uint8_t *glyphs;
+    uint32_t glyph_count;
+    uint32_t glyph_bytes;
+    int width;
+
+    // BDF font bounding box
+    int bbx_w, bbx_h, bbx_x, bbx_y;
+
+    FontIndexEntry *index;  // NULL for a PSF2 font without a Unicode table
+    uint32_t index_count;
+} Font;
+
+/* Open a .psf (PSF2) or .bdf file; returns 0 or -1 */
+int font_open(Font *f, const char *path);
+
+/* Same for a font already in memory, which must outlive the Font */
+int font_open_memory(Font *f, const void *data, size_t size);
+
+void font_close(Font *f);
+
+/* Decode one UTF-8 sequence and advance *s; invalid bytes give U+FFFD */
+uint32_t utf8_next(const char **s);
+
+/* One rasterised glyph in the cache */
+typedef struct {
+    uint32_t cp;
+    int16_t advance;        // pixels to the next glyph = width of the cached cell
+    int16_t prev, next;     // LRU list, -1 = end
+    int16_t chain;          // next slot in the same hash bucket, -1 = end
+} FontCacheSlot;
+
+/* Bounded LRU cache of glyphs rasterised to RGB565 for one colour pair
+ *
+ * A cached glyph is a full line-height cell, ink on background, so drawing
+ * it is one memcpy per row. When every slot is taken, the least recently
+ * drawn glyph is evicted.
+ */
+typedef struct {
+    const Font *font;
+    uint16_t fg, bg;
+
+    int num_slots;
+    int used;
+    FontCacheSlot *slots;
+    uint16_t *pixels;       // num_slots cells of font->height rows x max_width
+    int16_t *buckets;       // hash heads, num_buckets entries, -1 = empty
+    int num_buckets;        // power of two
+    int16_t mru, lru;
+
+    uint32_t hits, misses, evictions;
+} FontCache;
+
+/* `num_slots` glyphs of at most FONT_MAX_CELL x FONT_MAX_CELL; returns 0 or -1 */
+int font_cache_init(FontCache *c, const Font *f, int num_slots, uint16_t fg, uint16_t bg);
+void font_cache_free(FontCache *c);
+
+/* Draw a UTF-8 string with its top-left corner at (x, y), clipped to the
+ * canvas; returns the x after the last glyph
+ */
+int font_draw_text(Canvas *dst, int x, int y, const char *utf8, FontCache *c);
+
+/* Advance width of a UTF-8 string in pixels */
+int font_text_width(FontCache *c, const char *utf8);
+
+#endif
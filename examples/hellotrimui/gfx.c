@@ -0,0 +1,171 @@
+#include <string.h>
+
+#include "gfx.h"
+
+/* Store `n` copies of the 32-bit word `v`; returns the pointer past the last one
+ * On ARM the bulk is written as 8-word stmia bursts, which the ARM926 write
+ * buffer drains much faster than single str instructions. The four values
+ * are pinned to distinct registers so the compiler cannot collapse them into
+ * one, which would shrink the register list of the stmia.
+ */
+static inline uint32_t *fill_words(uint32_t *w, uint32_t v, int n) {
+#if defined(__arm__) && !defined(__thumb__)
+    register uint32_t r4 __asm__("r4") = v;
+    register uint32_t r5 __asm__("r5") = v;
+    register uint32_t r6 __asm__("r6") = v;
+    register uint32_t r7 __asm__("r7") = v;
+    for (; n >= 8; n -= 8) {
+        __asm__ volatile("stmia %0!, {%1, %2, %3, %4}\n\t"
+                         "stmia %0!, {%1, %2, %3, %4}"
+                         : "+r"(w)
+                         : "r"(r4), "r"(r5), "r"(r6), "r"(r7)
+                         : "memory");
+    }
+#else
+    for (; n >= 8; n -= 8) {
+        w[0] = v; w[1] = v; w[2] = v; w[3] = v;
+        w[4] = v; w[5] = v; w[6] = v; w[7] = v;
+        w += 8;
+    }
+#endif
+    while (n-- > 0) *w++ = v;
+    return w;
+}
+
+void gfx_fill_span(uint16_t *dst, int n, uint16_t color) {
+    if (n <= 0) return;
+
+    // Unaligned head pixel
+    if ((uintptr_t)dst & 2) {
+        *dst++ = color;
+        n--;
+    }
+
+    // Aligned middle, two pixels per word
+    uint32_t pair = color | ((uint32_t)color << 16);
+    dst = (uint16_t *)fill_words((uint32_t *)dst, pair, n >> 1);
+
+    // Unaligned tail pixel
+    if (n & 1) *dst = color;
+}
+
+/* Clip (x, y, w, h) against the canvas; returns 0 if nothing is left */
+static int clip_rect(const Canvas *c, int *x, int *y, int *w, int *h) {
+    if (*x < 0) { *w += *x; *x = 0; }
+    if (*y < 0) { *h += *y; *y = 0; }
+    if (*x + *w > c->width)  *w = c->width - *x;
+    if (*y + *h > c->height) *h = c->height - *y;
+    return *w > 0 && *h > 0;
+}
+
+/* Clip a block transfer against both canvases, keeping src and dst in step */
+static int clip_blit(const Canvas *dst, int *dx, int *dy,
+                     const Canvas *src, int *sx, int *sy, int *w, int *h) {
+    int x = *sx, y = *sy;
+    if (!clip_rect(src, &x, &y, w, h)) return 0;
+    *dx += x - *sx;
+    *dy += y - *sy;
+    *sx = x;
+    *sy = y;
+
+    x = *dx;
+    y = *dy;
+    if (!clip_rect(dst, &x, &y, w, h)) return 0;
+    *sx += x - *dx;
+    *sy += y - *dy;
+    *dx = x;
+    *dy = y;
+    return 1;
+}
+
+void gfx_fill(Canvas *dst, int x, int y, int w, int h, uint16_t color) {
+    if (!clip_rect(dst, &x, &y, &w, &h)) return;
+
+    uint8_t *line = dst->pixels + y * dst->stride + x * 2;
+    for (int row = 0; row < h; row++) {
+        gfx_fill_span((uint16_t *)line, w, color);
+        line += dst->stride;
+    }
+}
+
+void gfx_clear(Canvas *dst, uint16_t color) {
+    // Tightly packed canvases are one long span
+    if (dst->stride == dst->width * 2) {
+        gfx_fill_span((uint16_t *)dst->pixels, dst->width * dst->height, color);
+    } else {
+        gfx_fill(dst, 0, 0, dst->width, dst->height, color);
+    }
+}
+
+void gfx_copy(Canvas *dst, int dx, int dy,
+              const Canvas *src, int sx, int sy, int w, int h) {
+    if (!clip_blit(dst, &dx, &dy, src, &sx, &sy, &w, &h)) return;
+
+    const uint8_t *s = src->pixels + sy * src->stride + sx * 2;
+    uint8_t *d = dst->pixels + dy * dst->stride + dx * 2;
+    int sstride = src->stride;
+    int dstride = dst->stride;
+    size_t len = (size_t)w * 2;
+
+    // Scrolling a canvas down onto itself: walk rows bottom-up
+    if (dst->pixels == src->pixels && dy > sy) {
+        s += (h - 1) * sstride;
+        d += (h - 1) * dstride;
+        sstride = -sstride;
+        dstride = -dstride;
+    }
+
+    int same = dst->pixels == src->pixels && dy == sy;
+    for (int row = 0; row < h; row++) {
+        if (same) memmove(d, s, len);
+        else      memcpy(d, s, len);
+        s += sstride;
+        d += dstride;
+    }
+}
+
+/* Keyed copy of one row: word-at-a-time when src and dst share alignment */
+static void blit_key_span(uint16_t *d, const uint16_t *s, int n, uint16_t key) {
+    if ((((uintptr_t)d ^ (uintptr_t)s) & 2) == 0) {
+        if ((uintptr_t)d & 2 && n > 0) {
+            if (*s != key) *d = *s;
+            d++; s++; n--;
+        }
+
+        uint32_t key2 = key | ((uint32_t)key << 16);
+        const uint32_t *sw = (const uint32_t *)s;
+        uint32_t *dw = (uint32_t *)d;
+        for (; n >= 2; n -= 2) {
+            uint32_t v = *sw++;
+            uint32_t diff = v ^ key2;
+            if ((diff & 0xFFFF) && (diff >> 16)) {
+                *dw = v;                                  // both pixels opaque
+            } else if (diff) {
+                uint16_t *dp = (uint16_t *)dw;            // exactly one opaque
+                if (diff & 0xFFFF) dp[0] = (uint16_t)v;
+                else               dp[1] = (uint16_t)(v >> 16);
+            }
+            dw++;
+        }
+        s = (const uint16_t *)sw;
+        d = (uint16_t *)dw;
+    }
+
+    for (; n > 0; n--) {
+        if (*s != key) *d = *s;
+        d++; s++;
+    }
+}
+
+void gfx_blit_key(Canvas *dst, int dx, int dy,
+                  const Canvas *src, int sx, int sy, int w, int h, uint16_t key) {
+    if (!clip_blit(dst, &dx, &dy, src, &sx, &sy, &w, &h)) return;
+
+    const uint8_t *s = src->pixels + sy * src->stride + sx * 2;
+    uint8_t *d = dst->pixels + dy * dst->stride + dx * 2;
+    for (int row = 0; row < h; row++) {
+        blit_key_span((uint16_t *)d, (const uint16_t *)s, w, key);
+        s += src->stride;
+        d += dst->stride;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef TRIMUI_GFX_H
+#define TRIMUI_GFX_H
+
+#include <stdint.h>
+
+#include "surface.h"
+
+/* RGB565 drawing primitives
+ *
+ * Every call clips its rectangle against the canvas once up front, so the
+ * inner loops never test coordinates. Rows are written as an unaligned head
+ * pixel, an aligned middle of paired-pixel 32-bit words (stmia bursts on
+ * ARM), and an unaligned tail pixel.
+ */
+
+/* Pack 8-bit channels into RGB565 (RRRRRGGGGGGBBBBB) */
+static inline uint16_t rgb565(int r, int g, int b) {
+    return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+/* Fill `n` pixels starting at `dst` (no clipping) */
+void gfx_fill_span(uint16_t *dst, int n, uint16_t color);
+
+/* Fill a rectangle */
+void gfx_fill(Canvas *dst, int x, int y, int w, int h, uint16_t color);
+
+/* Clear the whole canvas */
+void gfx_clear(Canvas *dst, uint16_t color);
+
+/* Copy a w×h block from (sx, sy) in src to (dx, dy) in dst
+ * src and dst may be the same canvas and the regions may overlap.
+ */
+void gfx_copy(Canvas *dst, int dx, int dy,
+              const Canvas *src, int sx, int sy, int w, int h);
+
+/* Like gfx_copy, but pixels equal to `key` in src are left untouched in dst */
+void gfx_blit_key(Canvas *dst, int dx, int dy,
+                  const Canvas *src, int sx, int sy, int w, int h, uint16_t key);
+
+#endif
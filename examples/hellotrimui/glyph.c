@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "font8x8_basic.h"   // ← the correct, complete font file
+#include "glyph.h"
+
+static GlyphAtlas atlas_cache[GLYPH_MAX_ATLASES];
+static int atlas_count = 0;
+
+int glyph_atlas_init(GlyphAtlas *a, int scale, uint16_t fg, uint16_t bg, int opaque) {
+    if (scale < 1 || scale > GLYPH_MAX_SCALE) return -1;
+
+    memset(a, 0, sizeof(*a));
+    a->scale  = scale;
+    a->fg     = fg;
+    a->bg     = opaque ? bg : 0;
+    a->opaque = opaque;
+    a->cell_w = GLYPH_W * scale;
+    a->cell_h = GLYPH_H * scale;
+
+    if (opaque) {
+        a->pixels = malloc((size_t)GLYPH_COUNT * GLYPH_H * a->cell_w * sizeof(uint16_t));
+        if (!a->pixels) return -1;
+        a->owns_pixels = 1;
+    }
+
+    // One run of `scale` ink bits per set font bit (bit 0 = leftmost pixel)
+    uint32_t run = (1u << scale) - 1;
+    for (int g = 0; g < GLYPH_COUNT; g++) {
+        for (int row = 0; row < GLYPH_H; row++) {
+            uint8_t bits = (uint8_t)font8x8_basic[g][row];
+            uint32_t mask = 0;
+            for (int col = 0; col < GLYPH_W; col++) {
+                if (bits & (1 << col)) mask |= run << (col * scale);
+            }
+            a->masks[g][row] = mask;
+
+            if (opaque) {
+                uint16_t *px = a->pixels + (g * GLYPH_H + row) * a->cell_w;
+                for (int x = 0; x < a->cell_w; x++) {
+                    px[x] = (mask >> x) & 1 ? fg : bg;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+void glyph_atlas_free(GlyphAtlas *a) {
+    if (a->owns_pixels) free(a->pixels);
+    a->pixels = NULL;
+    a->owns_pixels = 0;
+}
+
+const GlyphAtlas *glyph_atlas_get(int scale, uint16_t fg, uint16_t bg, int opaque) {
+    if (!opaque) bg = 0;   // background is irrelevant for transparent text
+
+    for (int i = 0; i < atlas_count; i++) {
+        GlyphAtlas *a = &atlas_cache[i];
+        if (a->scale == scale && a->fg == fg && a->bg == bg && a->opaque == opaque) {
+            return a;
+        }
+    }
+
+    if (atlas_count == GLYPH_MAX_ATLASES) return NULL;
+    if (glyph_atlas_init(&atlas_cache[atlas_count], scale, fg, bg, opaque) < 0) return NULL;
+    return &atlas_cache[atlas_count++];
+}
+
+/* Fill the pixels selected by `mask` (bit 0 = pixel 0) on `rows` rows
+ * that share the word alignment of the first
+ *
+ * Clipped glyphs and other scales: after an odd head pixel, the mask is
+ * taken two bits at a time, a pair of ink pixels as one aligned 32-bit
+ * store and a lone one as a 16-bit store. The mask is decoded once for all
+ * the rows a source row is repeated on.
+ */
+static void write_mask(uint8_t *line, int stride, int rows, uint32_t mask, uint16_t color) {
+    if (!mask) return;
+    if ((uintptr_t)line & 2) {
+        if (mask & 1) {
+            for (int r = 0; r < rows; r++) *(uint16_t *)(line + r * stride) = color;
+        }
+        line += 2;
+        mask >>= 1;
+    }
+
+    uint32_t pair = color | ((uint32_t)color << 16);
+    for (; mask; mask >>= 2, line += 4) {
+        switch (mask & 3) {
+        case 3:
+            for (int r = 0; r < rows; r++) *(uint32_t *)(line + r * stride) = pair;
+            break;
+        case 1:
+            for (int r = 0; r < rows; r++) *(uint16_t *)(line + r * stride) = color;
+            break;
+        case 2:
+            for (int r = 0; r < rows; r++) *(uint16_t *)(line + r * stride + 2) = color;
+            break;
+        }
+    }
+}
+
+/* Word masks for 4 font bits at 2x: font bit i covers 32-bit word i */
+#define W 0xFFFFFFFFu
+static const uint32_t nibble_words[16][4] = {
+    { 0, 0, 0, 0 }, { W, 0, 0, 0 }, { 0, W, 0, 0 }, { W, W, 0, 0 },
+    { 0, 0, W, 0 }, { W, 0, W, 0 }, { 0, W, W, 0 }, { W, W, W, 0 },
+    { 0, 0, 0, W }, { W, 0, 0, W }, { 0, W, 0, W }, { W, W, 0, W },
+    { 0, 0, W, W }, { W, 0, W, W }, { 0, W, W, W }, { W, W, W, W },
+};
+#undef W
+
+/* The same at an odd x, where word i holds the second pixel of font bit
+ * i - 1 (low half) and the first of bit i (high half); indexed by the
+ * nibble shifted up one, with the bit before it in bit 0
+ */
+#define L 0x0000FFFFu
+#define H 0xFFFF0000u
+static const uint32_t odd_nibble_words[32][4] = {
+    { 0, 0, 0, 0 }, { L, 0, 0, 0 }, { H, L, 0, 0 }, { L|H, L, 0, 0 },
+    { 0, H, L, 0 }, { L, H, L, 0 }, { H, L|H, L, 0 }, { L|H, L|H, L, 0 },
+    { 0, 0, H, L }, { L, 0, H, L }, { H, L, H, L }, { L|H, L, H, L },
+    { 0, H, L|H, L }, { L, H, L|H, L }, { H, L|H, L|H, L }, { L|H, L|H, L|H, L },
+    { 0, 0, 0, H }, { L, 0, 0, H }, { H, L, 0, H }, { L|H, L, 0, H },
+    { 0, H, L, H }, { L, H, L, H }, { H, L|H, L, H }, { L|H, L|H, L, H },
+    { 0, 0, H, L|H }, { L, 0, H, L|H }, { H, L, H, L|H }, { L|H, L, H, L|H },
+    { 0, H, L|H, L|H }, { L, H, L|H, L|H }, { H, L|H, L|H, L|H }, { L|H, L|H, L|H, L|H },
+};
+#undef L
+#undef H
+
+/* Font bits 0-3 of a 2x row mask (every pixel pair is one font bit) */
+static inline uint32_t font_nibble(uint32_t mask) {
+    mask &= 0x55;
+    mask = (mask | mask >> 1) & 0x33;
+    return (mask | mask >> 2) & 0x0F;
+}
+
+/* A whole 2x glyph row on `rows` rows, as above: eight 32-bit words, each
+ * pixel kept or replaced by mask, with no test per font bit. At an odd x word j holds the second
+ * pixel of font bit j - 1 and the first of bit j; the words start one pixel
+ * early (its bit is clear, so it is written back unchanged) and the last
+ * pixel is stored on its own.
+ */
+static void write_row_2x(uint8_t *line, int stride, int rows, uint32_t mask, uint16_t color) {
+    const uint32_t *lo = nibble_words[font_nibble(mask)];
+    const uint32_t *hi = nibble_words[font_nibble(mask >> 8)];
+    uint32_t pair = color | ((uint32_t)color << 16);
+
+    if (!((uintptr_t)line & 2)) {
+        for (int r = 0; r < rows; r++, line += stride) {
+            uint32_t *d = (uint32_t *)line;
+            for (int i = 0; i < 4; i++) {
+                d[i] = (d[i] & ~lo[i]) | (pair & lo[i]);
+                d[i + 4] = (d[i + 4] & ~hi[i]) | (pair & hi[i]);
+            }
+        }
+        return;
+    }
+
+    uint32_t lo_bits = font_nibble(mask), hi_bits = font_nibble(mask >> 8);
+    lo = odd_nibble_words[lo_bits << 1];
+    hi = odd_nibble_words[hi_bits << 1 | lo_bits >> 3];
+    line -= 2;
+    for (int r = 0; r < rows; r++, line += stride) {
+        uint32_t *d = (uint32_t *)line;
+        for (int i = 0; i < 4; i++) {
+            d[i] = (d[i] & ~lo[i]) | (pair & lo[i]);
+            d[i + 4] = (d[i + 4] & ~hi[i]) | (pair & hi[i]);
+        }
+        if (hi_bits & 8) *(uint16_t *)(line + 32) = color;
+    }
+}
+
+/* Draw glyph `g` with its top-left corner at (x, y), clipped to the canvas */
+static void draw_glyph(Canvas *dst, int x, int y, int g, const GlyphAtlas *a) {
+    // Clip the cell once, then work in cell coordinates [c0, c1) x [r0, r1)
+    int c0 = x < 0 ? -x : 0;
+    int r0 = y < 0 ? -y : 0;
+    int c1 = x + a->cell_w > dst->width  ? dst->width  - x : a->cell_w;
+    int r1 = y + a->cell_h > dst->height ? dst->height - y : a->cell_h;
+    if (c0 >= c1 || r0 >= r1) return;
+
+    int cols = c1 - c0;
+    uint32_t window = cols == 32 ? 0xFFFFFFFFu : ((1u << cols) - 1) << c0;
+
+    uint8_t *line = dst->pixels + (y + r0) * dst->stride + (x + c0) * 2;
+    int src_row = r0 / a->scale;
+
+    if (!a->opaque) {
+        // One source row at a time, written on every screen row it covers;
+        // row by row if a stride of 4n + 2 bytes alternates the alignment
+        int whole_2x = a->scale == 2 && cols == a->cell_w;
+        for (int r = r0; r < r1;) {
+            int end = (src_row + 1) * a->scale < r1 ? (src_row + 1) * a->scale : r1;
+            int n = dst->stride & 3 ? 1 : end - r;
+            uint32_t mask = a->masks[g][src_row];
+            if (whole_2x) {
+                if (mask) write_row_2x(line, dst->stride, n, mask, a->fg);
+            } else {
+                write_mask(line, dst->stride, n, (mask & window) >> c0, a->fg);
+            }
+            line += n * dst->stride;
+            r += n;
+            if (r == end) src_row++;
+        }
+        return;
+    }
+
+    int rep = r0 - src_row * a->scale;
+    for (int r = r0; r < r1; r++) {
+        const uint16_t *src = a->pixels + (g * GLYPH_H + src_row) * a->cell_w + c0;
+        memcpy(line, src, cols * sizeof(uint16_t));
+
+        line += dst->stride;
+        if (++rep == a->scale) {
+            rep = 0;
+            src_row++;
+        }
+    }
+}
+
+int draw_text(Canvas *dst, int x, int y, const char *text, const GlyphAtlas *a) {
+    if (!a) return x;
+    for (; *text; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c < GLYPH_COUNT && x < dst->width && x + a->cell_w > 0) {
+            draw_glyph(dst, x, y, c, a);
+        }
+        x += a->cell_w;
+    }
+    return x;
+}
+
+int text_width(const GlyphAtlas *a, const char *text) {
+    return (int)strlen(text) * a->cell_w;
+}
+
+void draw_text_2x(Canvas *dst, int x, int y, const char *text, uint16_t color) {
+    // Cached atlases are never freed: remember the last one instead of
+    // searching the cache on every call
+    static const GlyphAtlas *last;
+    if (!last || last->fg != color) last = glyph_atlas_get(2, color, 0, 0);
+    draw_text(dst, x, y, text, last);
+}
@@ -0,0 +1,55 @@
+#ifndef TRIMUI_GLYPH_H
+#define TRIMUI_GLYPH_H
+
+#include <stdint.h>
+
+#include "surface.h"
+
+/* Size of a glyph in font8x8_basic before scaling */
+#define GLYPH_W 8
+#define GLYPH_H 8
+#define GLYPH_COUNT 128
+
+#define GLYPH_MAX_SCALE 4
+#define GLYPH_MAX_ATLASES 16
+
+/* Pre-expanded copy of font8x8_basic for one (scale, fg, bg) combination
+ *
+ * Each source row of each glyph is stored already scaled horizontally:
+ *   masks:  one 32-bit mask per row, bit n set = pixel n of the scaled row is ink
+ *   pixels: (opaque atlases only) the same row as ready-to-copy RGB565 pixels
+ * Vertical scaling is done by writing each row `scale` times, so drawing a
+ * glyph never tests individual font bits or recomputes addresses per pixel.
+ */
+typedef struct {
+    int scale;
+    uint16_t fg;
+    uint16_t bg;
+    int opaque;         // 1 = whole cell is written (fg on bg), 0 = ink pixels only
+    int cell_w;         // GLYPH_W * scale
+    int cell_h;         // GLYPH_H * scale
+    uint32_t masks[GLYPH_COUNT][GLYPH_H];
+    uint16_t *pixels;   // GLYPH_COUNT * GLYPH_H rows of cell_w pixels, or NULL
+    int owns_pixels;    // 0 when pixels point into an asset pack
+} GlyphAtlas;
+
+/* Build an atlas into caller-owned storage; returns 0 on success, -1 on failure */
+int glyph_atlas_init(GlyphAtlas *a, int scale, uint16_t fg, uint16_t bg, int opaque);
+void glyph_atlas_free(GlyphAtlas *a);
+
+/* Shared atlas cache: returns the atlas for this combination, building it on
+ * first use. Call it at startup for every style the app draws with.
+ * Returns NULL for an invalid scale or when all GLYPH_MAX_ATLASES are taken.
+ */
+const GlyphAtlas *glyph_atlas_get(int scale, uint16_t fg, uint16_t bg, int opaque);
+
+/* Draw text with an atlas, clipped to the canvas; returns the x after the last glyph */
+int draw_text(Canvas *dst, int x, int y, const char *text, const GlyphAtlas *a);
+
+/* Width in pixels of `text` drawn with `a` */
+int text_width(const GlyphAtlas *a, const char *text);
+
+/* Draw a string scaled 2× with transparent background */
+void draw_text_2x(Canvas *dst, int x, int y, const char *text, uint16_t color);
+
+#endif
@@ -14,372 +14,322 @@
 #include <time.h>
 #include <sys/time.h>
 
-#include "font8x8_basic.h"   // ← the correct, complete font file
-
-/* Button enumeration (inspired by libmmenu conventions)
- * In C, enums auto-increment: BUTTON_UP = 0, BUTTON_DOWN = 1, etc.
- * No need to explicitly assign each value unless you want specific numbers.
- */
-typedef enum {
-    BUTTON_UP = 0,
-    BUTTON_DOWN,
-    BUTTON_LEFT,
-    BUTTON_RIGHT,
-    BUTTON_A,
-    BUTTON_B,
-    BUTTON_X,
-    BUTTON_Y,
-    BUTTON_L,
-    BUTTON_R,
-    BUTTON_START,
-    BUTTON_SELECT,
-    BUTTON_MENU,
-    BUTTON_UNKNOWN,
-} Button;
-
-/* Map evdev KEY codes to logical buttons
- * TrimUI Model S button-to-evdev mappings:
- *   DPAD: UP=103, DOWN=108, LEFT=105, RIGHT=106
- *   Action buttons: X=42 (North), Y=56 (West), A=57 (East), B=29 (South)
- *   Shoulders: L=15, R=14
- *   Menu: SELECT=97, START=28, MENU=1
- * These codes are discovered by reading /dev/input/eventX with evdev
- */
-Button evdev_to_button(int code) {
-    switch (code) {
-    case 103:           return BUTTON_UP;       // UP = 103
-    case 108:           return BUTTON_DOWN;     // DOWN = 108
-    case 105:           return BUTTON_LEFT;     // LEFT = 105
-    case 106:           return BUTTON_RIGHT;    // RIGHT = 106
-    case 42:            return BUTTON_X;        // NORTH = 42
-    case 56:            return BUTTON_Y;        // WEST = 56
-    case 57:            return BUTTON_A;        // EAST = 57
-    case 29:            return BUTTON_B;        // SOUTH = 29
-    case 15:            return BUTTON_L;        // L = 15
-    case 14:            return BUTTON_R;        // R = 14
-    case 28:            return BUTTON_START;    // START = 28
-    case 97:            return BUTTON_SELECT;   // SELECT = 97
-    case 1:             return BUTTON_MENU;     // MENU = 1
-    default:            return BUTTON_UNKNOWN;
+#include "surface.h"
+#include "glyph.h"
+#include "audio.h"
+#include "monotime.h"
+#include "runloop.h"
+#include "input.h"
+#include "latency.h"
+#include "platform.h"
+#include "ui.h"
+#include "asset.h"
+#include "music.h"
+
+/* Everything the event callbacks need to reach */
+typedef struct {
+    Surface surf;
+    UiTree ui;
+    RunLoop loop;
+    Platform platform;
+    InputState buttons;
+    Audio audio;
+    AssetPack assets;       // assets.pak next to the binary, optional
+    Music music;            // music.wav next to the binary, optional
+    int audio_ok;
+    int music_ok;
+    int beep_sound;
+
+    UiWidget *button_label;
+    UiWidget *stats_label;
+    UiWidget *music_label;      // decoder stats, empty without music
+    UiWidget *latency_list;     // NULL unless TRIMUI_LATENCY is set
+
+    uint32_t shown_held;    // button mask the panel currently shows
+    int need_redraw;        // Only redraw when state changes
+
+    const char *latency_path;   // TRIMUI_LATENCY: instrumentation on, dump here
+    uint64_t unpresented_us;    // oldest press not yet on screen, 0 = none
+} App;
+
+/* Input callback: a batch of events from one device (or from a replay) */
+static void on_input(const struct input_event *events, int count, void *user) {
+    App *app = user;
+
+    uint32_t presses = input_feed(&app->buttons, events, count);
+    if (!presses && app->buttons.down == app->shown_held) return;
+
+    if (presses && app->platform.monotonic && latency_enabled) {
+        uint64_t t = app->buttons.last_press_us;
+        latency_record(LAT_INPUT, (uint32_t)(monotime_us() - t));
+        if (!app->unpresented_us) app->unpresented_us = t;
     }
-}
 
-/* Get friendly button name */
-const char* button_name(Button btn) {
-    switch (btn) {
-    case BUTTON_UP:      return "UP";
-    case BUTTON_DOWN:    return "DOWN";
-    case BUTTON_LEFT:    return "LEFT";
-    case BUTTON_RIGHT:   return "RIGHT";
-    case BUTTON_A:       return "A";
-    case BUTTON_B:       return "B";
-    case BUTTON_X:       return "X";
-    case BUTTON_Y:       return "Y";
-    case BUTTON_L:       return "L";
-    case BUTTON_R:       return "R";
-    case BUTTON_START:   return "START";
-    case BUTTON_SELECT:  return "SELECT";
-    case BUTTON_MENU:    return "MENU";
-    default:             return "???";
+    // Beep on button press (queued to the mixer thread, no syscall)
+    if (presses && app->audio_ok) {
+        audio_play(&app->audio, app->beep_sound, 256,
+                   app->platform.monotonic ? app->buttons.last_press_us : 0);
+    }
+    // Exit on MENU button press
+    if (presses & BUTTON_BIT(BUTTON_MENU)) {
+        runloop_quit(&app->loop);
+        return;
     }
+
+    app->need_redraw = 1;
+    runloop_mark_dirty(&app->loop);
 }
 
-/* Play a simple beep on button press */
-void beep_on_button(void) {
-    // Non-blocking beep: fork a child process so event loop continues immediately
-    // This makes button presses feel instant instead of waiting for sound to finish
-    pid_t pid = fork();
-    if (pid == 0) {
-        // Child process: play beep and exit
-        int dsp = open("/dev/dsp", O_WRONLY | O_NONBLOCK);
-        if (dsp < 0) exit(0);
-        
-        // Brief 50ms beep at 8kHz
-        unsigned char beep[400];
-        for (int i = 0; i < 400; i++) {
-            beep[i] = (i % 2 == 0) ? 255 : 0;
-        }
-        
-        ssize_t written = write(dsp, beep, sizeof(beep));
-        (void)written;
-        close(dsp);
-        exit(0);
+/* Latency table rows: a header, then one line per stage */
+static void latency_row(int index, char *buf, int len, void *user) {
+    (void)user;
+    if (index == 0) {
+        snprintf(buf, len, "%-8s %7s %7s %7s", "us", "p50", "p99", "max");
+        return;
     }
-    // Parent continues immediately - no blocking!
+    LatencySummary sum;
+    latency_summary((LatencyStage)(index - 1), &sum);
+    snprintf(buf, len, "%-8s %7u %7u %7u",
+             latency_stage_name((LatencyStage)(index - 1)), sum.p50, sum.p99, sum.max);
 }
 
-/* Draw a single character scaled 2× in RGB565 */
-void draw_char_2x(uint8_t *fbp, int stride, int x, int y, char c, uint16_t color) {
-    if (c < 0 || c > 127) return;
-
-    const unsigned char *glyph = font8x8_basic[(int)c];
+/* Frame callback: runs on a timer tick, only when something is dirty */
+static void on_frame(void *user) {
+    App *app = user;
+    InputState *in = &app->buttons;
+    input_frame(in, monotime_us());
 
-    for (int row = 0; row < 8; row++) {
-        uint8_t bits = glyph[row];
+    // Auto-repeat is synthesised per frame, so keep frames coming while a
+    // repeating button is held; each repeat beeps like a press
+    if (input_repeating(in)) runloop_mark_dirty(&app->loop);
+    if (in->repeated && app->audio_ok) audio_play(&app->audio, app->beep_sound, 256, 0);
 
-        for (int col = 0; col < 8; col++) {
-            if (bits & (1 << col)) {
-                for (int dy = 0; dy < 2; dy++) {
-                    uint16_t *dst = (uint16_t *)(fbp + (y + row*2 + dy) * stride
-                                                 + (x + col*2) * 2);
-                    dst[0] = color;
-                    dst[1] = color;
+    // Update display based on actual button state, not elapsed time
+    // Show every held button (chords too), clear when all are released
+    if (app->need_redraw) {
+        char info[UI_TEXT_MAX];
+        if (in->held) {
+            char *p = info;
+            char *end = info + sizeof(info);
+            for (int b = 0; b < BUTTON_COUNT; b++) {
+                if (in->held & BUTTON_BIT(b)) {
+                    p += snprintf(p, end - p, "%s%s", p == info ? "" : "+",
+                                  button_name((Button)b));
+                    if (p >= end) p = end - 1;
                 }
             }
+            snprintf(p, end - p, " (code:%d)", in->last_code);
+        } else {
+            // Buttons were released or no button pressed yet
+            snprintf(info, sizeof(info), "No button pressed");
         }
+        app->shown_held = in->held;
+        ui_label_set(app->button_label, info);
+        app->need_redraw = 0;
     }
-}
 
-/* Draw a string scaled 2× */
-void draw_text_2x(uint8_t *fbp, int stride, int x, int y,
-                  const char *text, uint16_t color) {
-    while (*text) {
-        draw_char_2x(fbp, stride, x, y, *text, color);
-        x += 16; // 8px * 2 scale
-        text++;
+    // Only the glyph cells that changed since the last frame are drawn
+    ui_render(&app->ui);
+    platform_present(&app->platform);
+
+    if (app->unpresented_us) {
+        latency_record(LAT_PRESENT, (uint32_t)(monotime_us() - app->unpresented_us));
+        app->unpresented_us = 0;
     }
 }
 
-/* Clear rectangle (fill with color) */
-void fill_rect(uint8_t *fbp, int stride, int x, int y, int w, int h, uint16_t color) {
-    for (int yy = y; yy < y + h; yy++) {
-        if (yy < 0) continue;
-        uint16_t *row = (uint16_t *)(fbp + yy * stride);
-        for (int xx = x; xx < x + w; xx++) {
-            if (xx < 0) continue;
-            row[xx] = color;
-        }
+/* Stats hook: called about once a second while the loop is active */
+static void on_stats(const RunLoopStats *st, void *user) {
+    App *app = user;
+    ui_label_printf(app->stats_label, "%u wakeups/s  %u fps  %u%% idle",
+                    st->wakeups_per_sec, st->frames_per_sec, st->idle_pct);
+    if (app->music_ok) {
+        const Music *m = &app->music;
+        uint32_t cpu = music_cpu_centipct(m);
+        ui_label_printf(app->music_label, "music %u us/buf (max %u) %u.%02u%% cpu",
+                        m->decode_last_us, m->decode_max_us, cpu / 100, cpu % 100);
     }
+    ui_list_changed(app->latency_list);
+    runloop_mark_dirty(&app->loop);
 }
 
-int main() {
-    // Redirect stdio to prevent launcher interference
-    FILE *f_stdin = freopen("/dev/null", "r", stdin);
-    FILE *f_stdout = freopen("/dev/null", "w", stdout);
-    FILE *f_stderr = freopen("/dev/null", "w", stderr);
-    (void)f_stdin; (void)f_stdout; (void)f_stderr;
-    
-    // Ignore signals that might be sent by the launcher
-    signal(SIGTERM, SIG_IGN);
-    signal(SIGINT, SIG_IGN);
-    signal(SIGHUP, SIG_IGN);
-    signal(SIGTSTP, SIG_IGN);
-    signal(SIGCONT, SIG_IGN);
-    
-    // Try to take control of the console
-    int console = open("/dev/console", O_RDWR);
-    if (console >= 0) {
-        // Successfully opened console
-        (void)console; // Keep it open
-    }
-    
-    // Small delay to ensure proper initialization
-    usleep(100000); // 100ms
-    
-    // Set high priority to ensure we stay in foreground
-    int prio = nice(-20);
-    (void)prio; // Ignore return value
-    
-    // Detach from parent process
-    setsid();
-    
-    // Open framebuffer device
-    // Try with O_EXCL first to get exclusive access, fall back to shared mode
-    int fb = open("/dev/fb0", O_RDWR | O_EXCL);
-    if (fb < 0) {
-        // Try without O_EXCL if that failed
-        fb = open("/dev/fb0", O_RDWR);
-        if (fb < 0) {
-            return 1;
-        }
+/* Path of a file in the directory the binary lives in; returns 0 or -1 */
+static int exe_relative(char *buf, size_t len, const char *name) {
+    ssize_t n = readlink("/proc/self/exe", buf, len - 1);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    char *slash = strrchr(buf, '/');
+    if (!slash || (size_t)(slash + 1 - buf) + strlen(name) >= len) return -1;
+    strcpy(slash + 1, name);
+    return 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--record FILE] [--capture FILE]\n"
+            "       %s --headless [--replay FILE] [--ppm FILE] [--wav FILE] [--size WxH] [--capture FILE]\n",
+            argv0, argv0);
+}
+
+int main(int argc, char **argv) {
+    // Backend: the device by default, or a headless run on any Linux box
+    PlatformConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    int headless = 0;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(arg, "--headless"))                { headless = 1; continue; }
+        if (!val) { usage(argv[0]); return 2; }
+        if      (!strcmp(arg, "--record"))  cfg.record_path = val;
+        else if (!strcmp(arg, "--capture")) cfg.capture_path = val;
+        else if (!strcmp(arg, "--replay"))  cfg.replay_path = val;
+        else if (!strcmp(arg, "--ppm"))     cfg.ppm_path = val;
+        else if (!strcmp(arg, "--wav"))     cfg.wav_path = val;
+        else if (!strcmp(arg, "--size") && sscanf(val, "%dx%d", &cfg.width, &cfg.height) == 2) {}
+        else { usage(argv[0]); return 2; }
+        i++;
     }
-    
-    // Suspend the launcher so we can take over the screen and input
-    // (Kill -STOP pauses the process, -CONT resumes it)
-    int ret_kill1 = system("killall -STOP gmenunx 2>/dev/null");
-    int ret_kill2 = system("killall -STOP gmenu2x 2>/dev/null");
-    int ret_kill3 = system("killall -STOP MainUI 2>/dev/null");
-    (void)ret_kill1; (void)ret_kill2; (void)ret_kill3;
-
-    struct fb_var_screeninfo vinfo;
-    struct fb_fix_screeninfo finfo;
-
-    ioctl(fb, FBIOGET_VSCREENINFO, &vinfo);
-    ioctl(fb, FBIOGET_FSCREENINFO, &finfo);
-
-    // Map framebuffer into memory
-    // RGB565 format: 2 bytes per pixel (RRRRRGGGGGGBBBBB)
-    uint8_t *fbp = mmap(NULL, finfo.smem_len,
-                        PROT_READ | PROT_WRITE,
-                        MAP_SHARED, fb, 0);
-
-    int width  = vinfo.xres;        // 320
-    int height = vinfo.yres;        // 240
-    int stride = finfo.line_length; // 640 bytes (320 pixels * 2 bytes)
+
+    // Startup timing goes to the original stderr, before the device backend
+    // points it at /dev/null
+    uint64_t start_us = monotime_us();
+    int log_fd = dup(STDERR_FILENO);
+
+    static App app;
+    Platform *platform = &app.platform;
+    if (headless) platform_headless(platform, &cfg);
+    else          platform_fbdev(platform, &cfg);
+    if (platform->ops->enter) platform->ops->enter(platform);
+
+    // From here on every exit goes through `out`, which resumes the launcher
+    int status = 1;
+    int input_started = 0;
+    app.surf.fd = -1;
+    app.loop.timer_fd = -1;
+
+    // Optional input-to-photon instrumentation: TRIMUI_LATENCY=/path/to/dump.txt
+    app.latency_path = getenv("TRIMUI_LATENCY");
+    if (app.latency_path && *app.latency_path) latency_enable(1);
+
+    // Open the framebuffer and its off-screen back buffer
+    // All drawing below goes into surf.back; surface_flush() pushes the damage
+    if (platform->ops->open_video(platform, &app.surf) < 0) goto out;
+
+    int width  = app.surf.back.width;   // 320
+    int height = app.surf.back.height;  // 240
 
     // Colors
     uint16_t bg    = (0 << 11) | (0 << 5) | 31;  // dark blue
     uint16_t white = 0xFFFF;
 
-    // Fill background
-    for (int y = 0; y < height; y++) {
-        uint16_t *row = (uint16_t *)(fbp + y * stride);
-        for (int x = 0; x < width; x++) {
-            row[x] = bg;
-        }
-    }
-
-    const char *msg = "Hello Trimui";
+    // Text is drawn opaque: glyph cells paint their own background, so a
+    // changed character is simply drawn over the old one
+    const GlyphAtlas *big = glyph_atlas_get(2, white, bg, 1);
+    const GlyphAtlas *small = glyph_atlas_get(1, white, bg, 1);
 
     // Layout: title at top, button display in center, exit instruction at bottom
-    
-    // Title (top)
-    int title_x = (width  - 16 * strlen(msg)) / 2;
-    int title_y = 16;
-    draw_text_2x(fbp, stride, title_x, title_y, msg, white);
-
-    // Button display area (center, large and prominent)
-    int button_x = 8;
-    int button_y = 100;
-    int button_w = width - 16;
-    int button_h = 48;
-
-    char button_info[128] = "No button pressed";
-    int last_btn_code = -1;
-    Button last_btn = BUTTON_UNKNOWN;
-    int last_btn_state = 0;  // 0 = released, 1 = pressed
-    int prev_btn_code = -1;  // Track previous button to detect state changes
-    int prev_btn_state = 0;  // Track previous press/release state
-    Button prev_btn = BUTTON_UNKNOWN;
-    int need_redraw = 1;  // Flag to only redraw when state changes (instant response)
-    
-    // Exit instruction (bottom)
-    const char *exit_msg = "Press MENU to exit";
-    int exit_x = (width - 16 * strlen(exit_msg)) / 2;
-    int exit_y = height - 32;
-    
+    UiTree *ui = &app.ui;
+    ui_init(ui, &app.surf);
+    UiWidget *root = ui_panel(ui, NULL, 0, 0, width, height, bg);
+    ui_label_set(ui_label(ui, root, 0, 16, width, big, UI_ALIGN_CENTER), "Hello Trimui");
+    if (latency_enabled) {
+        app.latency_list = ui_list(ui, root, 8, 44, width - 16, small->cell_h * (LAT_COUNT + 1),
+                                   small, NULL, latency_row, NULL);
+        ui_list_set_count(app.latency_list, LAT_COUNT + 1);
+    }
+    app.button_label = ui_label(ui, root, 8, 100, width - 16, big, UI_ALIGN_LEFT);
+    ui_label_set(app.button_label, "No button pressed");
+    ui_label_set(ui_label(ui, root, 0, height - 32, width, big, UI_ALIGN_CENTER), "Press MENU to exit");
+    app.stats_label = ui_label(ui, root, 0, height - small->cell_h, width, small, UI_ALIGN_LEFT);
+    app.music_label = ui_label(ui, root, 0, height - 2 * small->cell_h, width, small, UI_ALIGN_LEFT);
+
     // Draw initial state
-    fill_rect(fbp, stride, button_x, button_y, button_w, button_h, bg);
-    draw_text_2x(fbp, stride, button_x, button_y, button_info, white);
-    draw_text_2x(fbp, stride, exit_x, exit_y, exit_msg, white);
-
-    // Prepare input devices (try event0-event15, only open ones that exist)
-    // Linux input subsystem exposes button presses via /dev/input/eventN
-    // Multiple devices may report the same button, so we monitor all of them
-    // O_NONBLOCK ensures read() returns immediately if no data available
-    #define MAX_EV 16
-    int evfds[MAX_EV];
-    int num_evs = 0;  // Track how many event devices we actually opened
-    for (int i = 0; i < MAX_EV; i++) evfds[i] = -1;
-    for (int i = 0; i < MAX_EV; i++) {
-        char path[64];
-        snprintf(path, sizeof(path), "/dev/input/event%d", i);
-        int fd = open(path, O_RDONLY | O_NONBLOCK);
-        if (fd >= 0) {
-            evfds[i] = fd;
-            num_evs++;
-        }
+    ui_render(ui);
+    platform_present(platform);
+
+    if (log_fd >= 0) {
+        dprintf(log_fd, "startup: %s, launchers stopped %d (waited %u us), first frame %u us\n",
+                platform->ops->name, platform->launcher.count, platform->launcher.wait_us,
+                (unsigned)(monotime_us() - start_us));
+        close(log_fd);
     }
 
-    // Use poll() to efficiently wait for input on multiple devices
-    // Much better than spinning in a loop checking each device
-    struct pollfd pfds[MAX_EV];
-    int active_fds = 0;
-    for (int i = 0; i < MAX_EV; i++) {
-        if (evfds[i] >= 0) {
-            pfds[active_fds].fd = evfds[i];
-            pfds[active_fds].events = POLLIN;
-            active_fds++;
-        }
+    // Open the sound device once; the mixer thread keeps it fed from here on
+    app.audio_ok = platform->ops->open_audio(platform, &app.audio) == 0;
+    int rate = app.audio_ok ? app.audio.rate : AUDIO_RATE;
+
+    // Beep: 50ms, 1kHz square wave, generated once and played from memory
+    // A "beep" sound in assets.pak replaces it, played straight from the
+    // mapping, as long as it was made for the rate the device runs at.
+    // The driver may pick any rate: room for 50ms at up to 48kHz
+    static int16_t beep_pcm[48000 / 20];
+    const int16_t *beep = beep_pcm;
+    int tone_len = (rate < 48000 ? rate : 48000) / 20;
+    int beep_len = tone_len, beep_rate = 0;
+    char path[512];
+    if (exe_relative(path, sizeof(path), "assets.pak") == 0 &&
+        asset_pack_open(&app.assets, path) == 0 &&
+        asset_sound(&app.assets, "beep", &beep, &beep_len, &beep_rate) == 0 && beep_rate != rate) {
+        fprintf(stderr, "assets.pak: beep is %d Hz but audio runs at %d Hz, using the built-in tone\n",
+                beep_rate, rate);
+        beep = beep_pcm;
+        beep_len = tone_len;
     }
+    if (beep == beep_pcm) audio_square_wave(beep_pcm, beep_len, rate, 1000, 8000);
+    app.beep_sound = app.audio_ok ? audio_add_sound(&app.audio, beep, beep_len) : -1;
 
-    int timeout_ms = 1; // 1ms timeout for ultra-responsive display updates (instant feel)
-    int running = 1;
-    while (running) {
-        if (active_fds == 0) {
-            // No input devices found: wait indefinitely for input
-            usleep(100 * 1000);
-            continue;
-        }
-        int ret = poll(pfds, active_fds, timeout_ms);
-        for (int i = 0; i < active_fds; i++) {
-            if (pfds[i].revents & POLLIN) {
-                struct input_event ev;
-                // Read multiple events in a loop to not miss any
-                while (read(pfds[i].fd, &ev, sizeof(ev)) == (ssize_t)sizeof(ev)) {
-                    if (ev.type == EV_KEY) {
-                        Button btn = evdev_to_button(ev.code);
-                        
-                        // Ignore unknown buttons
-                        if (btn == BUTTON_UNKNOWN) continue;
-                        
-                        // Only redraw on meaningful state changes
-                        int state_changed = 0;
-                        
-                        if (ev.value == 1) {
-                            // Button press - always show it
-                            if (btn != last_btn || ev.code != last_btn_code || last_btn_state != 1) {
-                                state_changed = 1;
-                            }
-                        } else if (ev.value == 0) {
-                            // Button release - only clear if it's the button we're displaying
-                            if (btn == last_btn && last_btn_state == 1) {
-                                state_changed = 1;
-                            }
-                        }
-                        
-                        if (state_changed) {
-                            last_btn = btn;
-                            last_btn_code = ev.code;
-                            last_btn_state = ev.value;
-                            prev_btn = btn;
-                            prev_btn_code = ev.code;
-                            prev_btn_state = ev.value;
-                            need_redraw = 1;
-                        }
-                        
-                        // Beep on button press
-                        if (ev.value == 1) {
-                            beep_on_button();
-                        }
-                        // Exit on MENU button press
-                        if (btn == BUTTON_MENU && ev.value == 1) {
-                            running = 0;
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-        
-        // Update display based on actual button state, not elapsed time
-        // Show button when pressed (state=1), clear when released (state=0)
-        if (need_redraw) {
-            if (last_btn != BUTTON_UNKNOWN && last_btn_state == 1) {
-                // Button is currently pressed
-                snprintf(button_info, sizeof(button_info), "%s (code:%d)", button_name(last_btn), last_btn_code);
-            } else {
-                // Button was released or no button pressed yet
-                snprintf(button_info, sizeof(button_info), "No button pressed");
-            }
-            
-            fill_rect(fbp, stride, button_x, button_y, button_w, button_h, bg);
-            draw_text_2x(fbp, stride, button_x, button_y, button_info, white);
-            need_redraw = 0;
-        }
+    // Background music: an IMA-ADPCM music.wav next to the binary, looped
+    // and streamed from the SD card by its own decoder thread
+    if (app.audio_ok && exe_relative(path, sizeof(path), "music.wav") == 0 &&
+        music_open(&app.music, path, app.audio.rate, 1) == 0) {
+        app.music.volume = 128;
+        audio_set_music(&app.audio, &app.music);
+        app.music_ok = 1;
     }
 
-    // Close input fds
-    for (int i = 0; i < MAX_EV; i++) if (evfds[i] >= 0) close(evfds[i]);
+    // Frame pacing: 60 fps while something changes, no wakeups while idle
+    if (runloop_init(&app.loop, 60) < 0) goto out;
+    runloop_set_frame(&app.loop, on_frame, &app);
+    runloop_set_stats(&app.loop, on_stats, &app);
 
-    // Resume launcher processes before exiting
-    int ret_resume1 = system("killall -CONT gmenunx 2>/dev/null");
-    int ret_resume2 = system("killall -CONT gmenu2x 2>/dev/null");
-    int ret_resume3 = system("killall -CONT MainUI 2>/dev/null");
-    (void)ret_resume1; (void)ret_resume2; (void)ret_resume3;
+    // Button mapping: built-in TrimUI layout, overridable by keymap.cfg
+    // placed next to the binary (no recompile needed to remap)
+    input_init(&app.buttons);
+    if (exe_relative(path, sizeof(path), "keymap.cfg") == 0) input_load_map(&app.buttons, path);
 
-    munmap(fbp, finfo.smem_len);
-    close(fb);
+    // Input only needs to cover the mapped buttons
+    static int codes[KEY_CNT];
+    int num_codes = input_mapped_codes(&app.buttons, codes, KEY_CNT);
+    platform_set_input(platform, &app.buttons, codes, num_codes, on_input, &app);
+    if (platform->ops->start_input(platform, &app.loop) < 0) goto out;
+    input_started = 1;
 
-    return 0;
+    runloop_run(&app.loop);
+    status = 0;
+
+out:
+    // Close input devices
+    if (input_started) platform->ops->stop_input(platform);
+    runloop_free(&app.loop);
+
+    if (app.audio_ok) audio_close(&app.audio);
+    if (app.music_ok) {
+        uint32_t cpu = music_cpu_centipct(&app.music);
+        fprintf(stderr, "music: %u buffers, decode avg %u max %u us, %u.%02u%% cpu, "
+                "read max %u us, %u loops, %u underruns\n",
+                app.music.buffers, (unsigned)(app.music.decode_sum_us / app.music.buffers),
+                app.music.decode_max_us, cpu / 100, cpu % 100, app.music.read_max_us,
+                app.music.loops, app.music.underruns);
+        music_close(&app.music);
+    }
+    asset_pack_close(&app.assets);
+
+    if (latency_enabled) latency_dump(app.latency_path);
+
+    if (platform->ops->leave) platform->ops->leave(platform);
+    ui_free(&app.ui);
+    surface_close(&app.surf);
+
+    return status;
 }
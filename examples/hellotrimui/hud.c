@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/timerfd.h>
+
+#include "hud.h"
+#include "gfx.h"
+#include "monotime.h"
+
+#define HUD_BG 0x0000
+
+void hud_init(Hud *h) {
+    memset(h, 0, sizeof(*h));
+    h->combo[0] = HUD_COMBO_A;
+    h->combo[1] = HUD_COMBO_B;
+    h->stat_fd = -1;
+    h->timer_fd = -1;
+}
+
+void hud_free(Hud *h) {
+    if (h->stat_fd >= 0) close(h->stat_fd);
+    if (h->timer_fd >= 0) close(h->timer_fd);
+    free(h->saved);
+    h->stat_fd = h->timer_fd = -1;
+    h->saved = NULL;
+    h->saved_valid = 0;
+    h->visible = 0;
+}
+
+HudEvent hud_feed(Hud *h, const struct input_event *ev) {
+    static InputState defaults;
+    static int defaults_ready;
+
+    if (ev->type == EV_SYN) return HUD_PASS;
+    h->events++;
+    if (ev->type != EV_KEY) return HUD_PASS;
+
+    if (!h->input && !defaults_ready) {
+        input_init(&defaults);
+        defaults_ready = 1;
+    }
+    Button btn = input_map_code(h->input ? h->input : &defaults, ev->code);
+    if (btn == BUTTON_UNKNOWN) return HUD_PASS;
+
+    HudEvent result = HUD_PASS;
+    for (int k = 0; k < 2; k++) {
+        if (btn != h->combo[k]) continue;
+        uint32_t bit = 1u << k;
+        if (ev->value == 2) {
+            // Kernel autorepeat: follows whatever happened to the press
+            if (h->swallowed & bit) result = HUD_SWALLOW;
+        } else if (ev->value) {
+            h->combo_down |= bit;
+            if (h->combo_down == 3) {
+                h->swallowed |= bit;
+                result = HUD_TOGGLE;
+            }
+        } else {
+            h->combo_down &= ~bit;
+            if (h->swallowed & bit) result = HUD_SWALLOW;
+            h->swallowed &= ~bit;
+        }
+    }
+    return result;
+}
+
+/* CPU ticks used and resident pages, from /proc/self/stat; returns 0 or -1 */
+static int read_stat(Hud *h, unsigned long *ticks, long *rss_pages) {
+    char buf[512];
+    if (h->stat_fd < 0) return -1;
+    ssize_t n = pread(h->stat_fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+
+    // The command name may contain spaces: fields are counted after its ')'
+    const char *p = strrchr(buf, ')');
+    unsigned long utime, stime;
+    if (!p || sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu "
+                     "%*d %*d %*d %*d %*d %*d %*u %*u %ld", &utime, &stime, rss_pages) != 3) {
+        return -1;
+    }
+    *ticks = utime + stime;
+    return 0;
+}
+
+int hud_show(Hud *h, Surface *s, int visible) {
+    if (!visible) {
+        if (!h->visible) return 0;
+        hud_free(h);
+        surface_damage(s, 0, 0, s->back.width, h->strip_h);    // the app's pixels again
+        return 0;
+    }
+    if (h->visible) return 0;
+
+    h->atlas = glyph_atlas_get(1, 0xFFFF, HUD_BG, 1);
+    if (!h->atlas) return -1;
+    h->strip_h = HUD_LINES * h->atlas->cell_h;
+    if (h->strip_h > s->back.height) h->strip_h = s->back.height;
+    h->saved = malloc((size_t)s->back.width * h->strip_h * sizeof(uint16_t));
+    h->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (!h->saved || h->timer_fd < 0) {
+        hud_free(h);
+        return -1;
+    }
+    struct itimerspec its = {
+        .it_interval = { HUD_REFRESH_US / 1000000u, HUD_REFRESH_US % 1000000u * 1000 },
+        .it_value    = { HUD_REFRESH_US / 1000000u, HUD_REFRESH_US % 1000000u * 1000 },
+    };
+    timerfd_settime(h->timer_fd, 0, &its, NULL);
+
+    h->stat_fd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+    long rss;
+    if (read_stat(h, &h->last_ticks, &rss) < 0) h->last_ticks = 0;
+    h->last_us = monotime_us();
+    h->events = 0;
+    snprintf(h->text[0], HUD_TEXT_MAX, "hud: measuring...");
+    h->text[1][0] = '\0';
+    h->visible = 1;
+    h->dirty = 1;
+    return 0;
+}
+
+void hud_refresh(Hud *h, const RunLoopStats *st, const Audio *a) {
+    if (!h->visible) return;
+    uint64_t now = monotime_us();
+    uint64_t elapsed = now - h->last_us;
+    if (!elapsed) elapsed = 1;
+
+    char cpu[16] = "?", rss[16] = "?";
+    unsigned long ticks;
+    long pages;
+    if (read_stat(h, &ticks, &pages) == 0) {
+        // Integer math only: this runs with -msoft-float
+        uint64_t used_us = (uint64_t)(ticks - h->last_ticks) * 1000000u / sysconf(_SC_CLK_TCK);
+        snprintf(cpu, sizeof(cpu), "%u%%", (unsigned)(used_us * 100 / elapsed));
+        snprintf(rss, sizeof(rss), "%ldk", pages * (sysconf(_SC_PAGESIZE) / 1024));
+        h->last_ticks = ticks;
+    }
+    uint32_t events_per_sec = (uint32_t)((uint64_t)h->events * 1000000u / elapsed);
+    h->events = 0;
+    h->last_us = now;
+
+    char text[HUD_LINES][HUD_TEXT_MAX];
+    snprintf(text[0], HUD_TEXT_MAX, "%u fps  frame %u.%u/%u.%u/%u.%u ms",
+             st->frames_per_sec,
+             st->frame_us_min / 1000, st->frame_us_min / 100 % 10,
+             st->frame_us_avg / 1000, st->frame_us_avg / 100 % 10,
+             st->frame_us_max / 1000, st->frame_us_max / 100 % 10);
+    snprintf(text[1], HUD_TEXT_MAX, "cpu %s  rss %s  in %u/s  xrun %u",
+             cpu, rss, events_per_sec, a ? a->underruns : 0);
+    if (memcmp(text, h->text, sizeof(text)) != 0) {
+        memcpy(h->text, text, sizeof(text));
+        h->dirty = 1;
+    }
+}
+
+void hud_draw(Hud *h, Surface *s) {
+    if (!h->visible) return;
+    Canvas *b = &s->back;
+    int row_bytes = b->width * (int)sizeof(uint16_t);
+
+    for (int y = 0; y < h->strip_h; y++) {
+        memcpy(h->saved + y * b->width, b->pixels + y * b->stride, row_bytes);
+    }
+    h->saved_valid = 1;
+
+    gfx_fill(b, 0, 0, b->width, h->strip_h, HUD_BG);
+    for (int i = 0; i < HUD_LINES; i++) draw_text(b, 0, i * h->atlas->cell_h, h->text[i], h->atlas);
+
+    // Unchanged text is already on screen, unless the app drew under it
+    if (h->dirty) {
+        surface_damage(s, 0, 0, b->width, h->strip_h);
+        h->dirty = 0;
+    }
+}
+
+void hud_restore(Hud *h, Surface *s) {
+    if (!h->saved_valid) return;
+    Canvas *b = &s->back;
+    int row_bytes = b->width * (int)sizeof(uint16_t);
+    for (int y = 0; y < h->strip_h; y++) {
+        memcpy(b->pixels + y * b->stride, h->saved + y * b->width, row_bytes);
+    }
+    h->saved_valid = 0;
+}
@@ -0,0 +1,82 @@
+#ifndef TRIMUI_HUD_H
+#define TRIMUI_HUD_H
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#include "surface.h"
+#include "glyph.h"
+#include "runloop.h"
+#include "audio.h"
+#include "input.h"
+
+#define HUD_LINES       2
+#define HUD_TEXT_MAX    48
+#define HUD_REFRESH_US  1000000u
+
+/* Default toggle: SELECT + R, wherever keymap.cfg puts them */
+#define HUD_COMBO_A     BUTTON_SELECT
+#define HUD_COMBO_B     BUTTON_R
+
+/* What hud_feed() makes of one event */
+typedef enum {
+    HUD_PASS = 0,       // not the HUD's: hand it to the app
+    HUD_SWALLOW,        // the completing combo key repeating or going up
+    HUD_TOGGLE,         // the press that completed the combo: toggle, swallow
+} HudEvent;
+
+/* Performance overlay in a strip across the top of the screen
+ *
+ * Shows frame rate, frame callback time (min/avg/max), CPU use and RSS from
+ * /proc/self/stat, input events per second and audio underruns, refreshed
+ * once a second. The strip is drawn into the back buffer just before a
+ * flush and the pixels under it are put back right after, so the app's
+ * back buffer (and any retained UI diffing on it) never sees the overlay.
+ * The strip is only marked damaged when its text changes.
+ *
+ * The platform layer owns one (Platform.hud): holding both combo buttons
+ * toggles it, and platform_present() draws it, so apps get it for free.
+ * The buttons are resolved through the app's InputState map, and the press
+ * that completes the combo (with that key's release) never reaches the app.
+ */
+typedef struct {
+    int visible;
+    Button combo[2];        // buttons to hold together, BUTTON_UNKNOWN = unused
+    uint32_t combo_down;    // bit i = combo[i] is held
+    uint32_t swallowed;     // bit i = combo[i]'s press was swallowed, so is its release
+    const InputState *input;    // code -> Button map, NULL = the default layout
+
+    const GlyphAtlas *atlas;
+    int strip_h;            // pixel rows reserved at the top
+    uint16_t *saved;        // back buffer rows under the strip
+    int saved_valid;        // saved holds the current frame's pixels
+    int dirty;              // text changed since it was last flushed
+
+    int stat_fd;            // /proc/self/stat, kept open and re-read
+    int timer_fd;           // refresh tick while visible, -1 when hidden
+    uint64_t last_us;
+    unsigned long last_ticks;   // utime + stime at last_us
+    uint32_t events;        // input events since the last refresh
+
+    char text[HUD_LINES][HUD_TEXT_MAX];
+} Hud;
+
+void hud_init(Hud *h);
+void hud_free(Hud *h);
+
+/* Count one input event and follow the combo buttons */
+HudEvent hud_feed(Hud *h, const struct input_event *ev);
+
+/* Show or hide the overlay; showing opens the refresh timer (h->timer_fd)
+ * and sizes the strip for the surface. Returns 0 or -1.
+ */
+int hud_show(Hud *h, Surface *s, int visible);
+
+/* Rebuild the text from the last stats window; `a` may be NULL */
+void hud_refresh(Hud *h, const RunLoopStats *st, const Audio *a);
+
+/* Around surface_flush(): draw the strip, then restore what was under it */
+void hud_draw(Hud *h, Surface *s);
+void hud_restore(Hud *h, Surface *s);
+
+#endif
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <strings.h>
+
+#include "input.h"
+#include "monotime.h"
+
+/* Map evdev KEY codes to logical buttons
+ * TrimUI Model S button-to-evdev mappings:
+ *   DPAD: UP=103, DOWN=108, LEFT=105, RIGHT=106
+ *   Action buttons: X=42 (North), Y=56 (West), A=57 (East), B=29 (South)
+ *   Shoulders: L=15, R=14
+ *   Menu: SELECT=97, START=28, MENU=1
+ * These codes are discovered by reading /dev/input/eventX with evdev
+ */
+static const struct {
+    uint16_t code;
+    uint8_t button;
+} default_map[] = {
+    { 103, BUTTON_UP },
+    { 108, BUTTON_DOWN },
+    { 105, BUTTON_LEFT },
+    { 106, BUTTON_RIGHT },
+    {  42, BUTTON_X },          // NORTH
+    {  56, BUTTON_Y },          // WEST
+    {  57, BUTTON_A },          // EAST
+    {  29, BUTTON_B },          // SOUTH
+    {  15, BUTTON_L },
+    {  14, BUTTON_R },
+    {  28, BUTTON_START },
+    {  97, BUTTON_SELECT },
+    {   1, BUTTON_MENU },
+};
+
+static const char *const button_names[BUTTON_COUNT] = {
+    "UP", "DOWN", "LEFT", "RIGHT", "A", "B", "X", "Y",
+    "L", "R", "START", "SELECT", "MENU",
+};
+
+const char *button_name(Button btn) {
+    return btn < BUTTON_COUNT ? button_names[btn] : "???";
+}
+
+Button button_from_name(const char *name) {
+    for (int b = 0; b < BUTTON_COUNT; b++) {
+        if (strcasecmp(name, button_names[b]) == 0) return (Button)b;
+    }
+    return BUTTON_UNKNOWN;
+}
+
+void input_init(InputState *in) {
+    memset(in, 0, sizeof(*in));
+    memset(in->map, BUTTON_UNKNOWN, sizeof(in->map));
+    for (size_t i = 0; i < sizeof(default_map) / sizeof(default_map[0]); i++) {
+        in->map[default_map[i].code] = default_map[i].button;
+    }
+    in->repeat_mask = BUTTON_DPAD;
+    in->repeat_delay_us = INPUT_REPEAT_DELAY_US;
+    in->repeat_rate_us = INPUT_REPEAT_RATE_US;
+    in->last_code = -1;
+}
+
+int input_load_map(InputState *in, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    int count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        char *eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+
+        // Button name, trimmed
+        char *name = line;
+        while (isspace((unsigned char)*name)) name++;
+        char *end = name + strlen(name);
+        while (end > name && isspace((unsigned char)end[-1])) *--end = '\0';
+
+        Button btn = button_from_name(name);
+        if (btn == BUTTON_UNKNOWN) continue;
+
+        // The file replaces the button's codes rather than adding to them
+        for (int code = 0; code < KEY_CNT; code++) {
+            if (in->map[code] == btn) in->map[code] = BUTTON_UNKNOWN;
+        }
+
+        char *p = eq + 1;
+        for (;;) {
+            char *next;
+            long code = strtol(p, &next, 0);
+            if (next == p) break;
+            if (code >= 0 && code < KEY_CNT) {
+                in->map[code] = (uint8_t)btn;
+                count++;
+            }
+            p = next;
+        }
+    }
+
+    fclose(f);
+    return count;
+}
+
+int input_mapped_codes(const InputState *in, int *codes, int max) {
+    int n = 0;
+    for (int code = 0; code < KEY_CNT && n < max; code++) {
+        if (in->map[code] != BUTTON_UNKNOWN) codes[n++] = code;
+    }
+    return n;
+}
+
+uint32_t input_feed(InputState *in, const struct input_event *ev, int count) {
+    uint32_t new_presses = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (ev[i].type != EV_KEY) continue;
+        Button btn = input_map_code(in, ev[i].code);
+        if (btn == BUTTON_UNKNOWN) continue;
+
+        uint32_t bit = BUTTON_BIT(btn);
+        if (ev[i].value == 1) {
+            in->down |= bit;
+            in->pending_pressed |= bit;
+            new_presses |= bit;
+            in->last_code = ev[i].code;
+            in->last_press_us = timeval_us(&ev[i].time);
+            in->next_repeat_us[btn] = 0;    // armed at the next input_frame()
+        } else if (ev[i].value == 0) {
+            in->down &= ~bit;
+            in->pending_released |= bit;
+        }
+        // value 2 is the kernel's own auto-repeat: we synthesise ours per frame
+    }
+    return new_presses;
+}
+
+void input_frame(InputState *in, uint64_t now_us) {
+    in->held = in->down;
+    in->pressed = in->pending_pressed;
+    in->released = in->pending_released;
+    in->repeated = 0;
+    in->pending_pressed = 0;
+    in->pending_released = 0;
+
+    uint32_t rep = in->held & in->repeat_mask;
+    while (rep) {
+        int b = __builtin_ctz(rep);
+        rep &= rep - 1;
+
+        if (in->pressed & BUTTON_BIT(b) || in->next_repeat_us[b] == 0) {
+            in->next_repeat_us[b] = now_us + in->repeat_delay_us;
+        } else if (now_us >= in->next_repeat_us[b]) {
+            in->pressed |= BUTTON_BIT(b);
+            in->repeated |= BUTTON_BIT(b);
+            in->next_repeat_us[b] += in->repeat_rate_us;
+            // Don't fire a burst after a long stall
+            if (in->next_repeat_us[b] < now_us) in->next_repeat_us[b] = now_us + in->repeat_rate_us;
+        }
+    }
+}
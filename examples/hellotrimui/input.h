@@ -0,0 +1,104 @@
+#ifndef TRIMUI_INPUT_H
+#define TRIMUI_INPUT_H
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/* Button enumeration (inspired by libmmenu conventions)
+ * In C, enums auto-increment: BUTTON_UP = 0, BUTTON_DOWN = 1, etc.
+ * No need to explicitly assign each value unless you want specific numbers.
+ * Each button is also one bit in the InputState masks: BUTTON_BIT(b).
+ */
+typedef enum {
+    BUTTON_UP = 0,
+    BUTTON_DOWN,
+    BUTTON_LEFT,
+    BUTTON_RIGHT,
+    BUTTON_A,
+    BUTTON_B,
+    BUTTON_X,
+    BUTTON_Y,
+    BUTTON_L,
+    BUTTON_R,
+    BUTTON_START,
+    BUTTON_SELECT,
+    BUTTON_MENU,
+    BUTTON_UNKNOWN,
+} Button;
+
+#define BUTTON_COUNT  BUTTON_UNKNOWN
+#define BUTTON_BIT(b) (1u << (b))
+#define BUTTON_DPAD   (BUTTON_BIT(BUTTON_UP) | BUTTON_BIT(BUTTON_DOWN) | \
+                       BUTTON_BIT(BUTTON_LEFT) | BUTTON_BIT(BUTTON_RIGHT))
+
+#define INPUT_REPEAT_DELAY_US 400000    // hold time before the first repeat
+#define INPUT_REPEAT_RATE_US   80000    // time between repeats
+
+/* Button state, snapshotted once per frame
+ *
+ * Events are mapped through a code → Button table (default TrimUI layout,
+ * optionally overridden from a config file) and accumulated between frames.
+ * input_frame() latches them into three masks, so game code can test
+ * chords and edges with plain AND instructions:
+ *   held     - buttons down at the end of the frame
+ *   pressed  - went down during the frame, plus synthesised auto-repeats
+ *   repeated - the synthesised auto-repeats alone
+ *   released - went up during the frame
+ * A press and release inside the same frame shows up in both edge masks.
+ */
+typedef struct {
+    uint8_t map[KEY_CNT];       // evdev code → Button
+
+    uint32_t held;
+    uint32_t pressed;
+    uint32_t repeated;
+    uint32_t released;
+
+    uint32_t down;              // live state, updated per event
+    uint32_t pending_pressed;   // edges since the last input_frame()
+    uint32_t pending_released;
+
+    uint32_t repeat_mask;       // buttons that auto-repeat (default: d-pad)
+    uint32_t repeat_delay_us;
+    uint32_t repeat_rate_us;
+    uint64_t next_repeat_us[BUTTON_COUNT];
+
+    int last_code;              // evdev code of the most recent press
+    uint64_t last_press_us;     // ev.time of the most recent press
+} InputState;
+
+/* Default TrimUI Model S mapping, d-pad auto-repeat */
+void input_init(InputState *in);
+
+/* Load "BUTTON = code [code ...]" lines on top of the current mapping
+ * A button listed in the file loses its previous codes. Blank lines and
+ * '#' comments are ignored. Returns the number of mappings read, or -1 if
+ * the file cannot be opened.
+ */
+int input_load_map(InputState *in, const char *path);
+
+/* Fill `codes` with every mapped evdev code; returns how many were written */
+int input_mapped_codes(const InputState *in, int *codes, int max);
+
+/* Feed a batch of events; returns the buttons newly pressed in this batch */
+uint32_t input_feed(InputState *in, const struct input_event *ev, int count);
+
+/* Latch the accumulated events into held/pressed/released for a new frame */
+void input_frame(InputState *in, uint64_t now_us);
+
+/* Held buttons that auto-repeat: holding one sends no further events, so
+ * the caller must keep frames coming while this is non-zero
+ */
+static inline uint32_t input_repeating(const InputState *in) {
+    return in->down & in->repeat_mask;
+}
+
+static inline Button input_map_code(const InputState *in, int code) {
+    return code >= 0 && code < KEY_CNT ? (Button)in->map[code] : BUTTON_UNKNOWN;
+}
+
+/* Get friendly button name, and back */
+const char *button_name(Button btn);
+Button button_from_name(const char *name);
+
+#endif
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "latency.h"
+
+typedef struct {
+    uint32_t ring[LATENCY_RING];
+    unsigned head;                      // samples written so far
+    uint32_t max;
+    uint32_t buckets[LATENCY_BUCKETS];
+} LatencyTrack;
+
+int latency_enabled = 0;
+static LatencyTrack tracks[LAT_COUNT];
+
+static const char *const stage_names[LAT_COUNT] = { "input", "present", "audio" };
+
+void latency_enable(int on) {
+    latency_enabled = on;
+}
+
+const char *latency_stage_name(LatencyStage stage) {
+    return stage < LAT_COUNT ? stage_names[stage] : "?";
+}
+
+void latency_record(LatencyStage stage, uint32_t us) {
+    if (!latency_enabled || stage >= LAT_COUNT) return;
+    LatencyTrack *t = &tracks[stage];
+
+    unsigned head = t->head;
+    t->ring[head & (LATENCY_RING - 1)] = us;
+    if (us > t->max) t->max = us;
+
+    int b = us ? 31 - __builtin_clz(us) : 0;
+    if (b >= LATENCY_BUCKETS) b = LATENCY_BUCKETS - 1;
+    t->buckets[b]++;
+
+    __atomic_store_n(&t->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+void latency_summary(LatencyStage stage, LatencySummary *out) {
+    memset(out, 0, sizeof(*out));
+    if (stage >= LAT_COUNT) return;
+    LatencyTrack *t = &tracks[stage];
+
+    unsigned head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+    unsigned n = head < LATENCY_RING ? head : LATENCY_RING;
+    out->count = head;
+    out->max = t->max;
+    if (n == 0) return;
+
+    // Sort a snapshot; only done when stats are displayed or dumped
+    uint32_t sorted[LATENCY_RING];
+    memcpy(sorted, t->ring, n * sizeof(sorted[0]));
+    qsort(sorted, n, sizeof(sorted[0]), cmp_u32);
+    out->p50 = sorted[(n - 1) * 50 / 100];
+    out->p99 = sorted[(n - 1) * 99 / 100];
+}
+
+int latency_dump(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "# stage count p50_us p99_us max_us\n");
+    for (int s = 0; s < LAT_COUNT; s++) {
+        LatencySummary sum;
+        latency_summary((LatencyStage)s, &sum);
+        fprintf(f, "%s %u %u %u %u\n", stage_names[s], sum.count, sum.p50, sum.p99, sum.max);
+    }
+
+    fprintf(f, "\n# histogram: stage bucket_low_us count\n");
+    for (int s = 0; s < LAT_COUNT; s++) {
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            if (tracks[s].buckets[b]) {
+                fprintf(f, "%s %u %u\n", stage_names[s], b ? 1u << b : 0u, tracks[s].buckets[b]);
+            }
+        }
+    }
+
+    return fclose(f);
+}
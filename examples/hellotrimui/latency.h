@@ -0,0 +1,47 @@
+#ifndef TRIMUI_LATENCY_H
+#define TRIMUI_LATENCY_H
+
+#include <stdint.h>
+
+#define LATENCY_RING     1024   // recent samples kept per stage (power of two)
+#define LATENCY_BUCKETS  24     // all-time log2 histogram: bucket n = [2^n, 2^(n+1)) us
+
+/* Measured intervals, all starting at the input event's ev.time */
+typedef enum {
+    LAT_INPUT = 0,      // ev.time → event handled by the app
+    LAT_PRESENT,        // ev.time → framebuffer write / page flip done
+    LAT_AUDIO,          // ev.time → beep fragment written to /dev/dsp, plus
+                        // the device queue ahead of it (GETODELAY)
+    LAT_COUNT,
+} LatencyStage;
+
+typedef struct {
+    uint32_t count;     // samples recorded since start
+    uint32_t p50;       // over the recent ring, in microseconds
+    uint32_t p99;
+    uint32_t max;       // all-time
+} LatencySummary;
+
+/* Input-to-photon instrumentation
+ *
+ * Off unless latency_enable() is called, in which case latency_record() is a
+ * few stores into a per-stage ring and histogram. Each stage has a single
+ * producer (the audio stage is fed from the mixer thread), so no locks are
+ * needed; readers may see a sample or two in flight, which is fine for stats.
+ */
+extern int latency_enabled;
+
+void latency_enable(int on);
+
+/* Record one sample for a stage; cheap no-op when disabled */
+void latency_record(LatencyStage stage, uint32_t us);
+
+/* Percentiles over the recent ring and the all-time max */
+void latency_summary(LatencyStage stage, LatencySummary *out);
+
+const char *latency_stage_name(LatencyStage stage);
+
+/* Write summaries and histograms as text; returns 0 or -1 */
+int latency_dump(const char *path);
+
+#endif
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+
+#include "launcher.h"
+#include "monotime.h"
+
+/* Launcher binaries shipped by the stock firmware and common frontends */
+static const char *const launcher_names[] = { "gmenunx", "gmenu2x", "MainUI" };
+
+/* Read /proc/<pid>/<file> into buf; returns the length or -1 */
+static int read_proc(pid_t pid, const char *file, char *buf, int len) {
+    char path[48];
+    snprintf(path, sizeof(path), "/proc/%d/%s", (int)pid, file);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, len - 1);
+    close(fd);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return (int)n;
+}
+
+/* Process name without the trailing newline, or "" if it is gone */
+static void read_comm(pid_t pid, char *comm, int len) {
+    if (read_proc(pid, "comm", comm, len) < 0) comm[0] = '\0';
+    comm[strcspn(comm, "\n")] = '\0';
+}
+
+/* True once the process is in stopped state (or no longer exists) */
+static int is_stopped(pid_t pid) {
+    char stat[256];
+    if (read_proc(pid, "stat", stat, sizeof(stat)) < 0) return 1;
+    // "pid (comm) S ...": the name may contain spaces, so look after the last ')'
+    char *p = strrchr(stat, ')');
+    return !p || p[1] == '\0' || p[2] == 'T' || p[2] == 't';
+}
+
+static int is_launcher(const char *comm) {
+    for (size_t i = 0; i < sizeof(launcher_names) / sizeof(launcher_names[0]); i++) {
+        if (strcmp(comm, launcher_names[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+int launcher_suspend(Launcher *l) {
+    memset(l, 0, sizeof(*l));
+
+    // One pass over /proc for all names at once
+    DIR *dir = opendir("/proc");
+    if (!dir) return 0;
+    struct dirent *de;
+    pid_t self = getpid();
+    while ((de = readdir(dir)) != NULL && l->count < LAUNCHER_MAX_PIDS) {
+        if (de->d_name[0] < '1' || de->d_name[0] > '9') continue;
+        pid_t pid = (pid_t)atoi(de->d_name);
+        if (pid == self) continue;
+
+        char comm[16];
+        read_comm(pid, comm, sizeof(comm));
+        if (!is_launcher(comm)) continue;
+        if (kill(pid, SIGSTOP) < 0) continue;
+
+        l->pids[l->count] = pid;
+        memcpy(l->names[l->count], comm, sizeof(comm));
+        l->count++;
+    }
+    closedir(dir);
+
+    // Handshake: wait until the kernel has actually stopped every launcher
+    uint64_t start = monotime_us();
+    for (;;) {
+        int pending = 0;
+        for (int i = 0; i < l->count; i++) pending += !is_stopped(l->pids[i]);
+        l->wait_us = (uint32_t)(monotime_us() - start);
+        if (!pending || l->wait_us >= LAUNCHER_WAIT_US) break;
+        usleep(1000);
+    }
+    return l->count;
+}
+
+void launcher_resume(Launcher *l) {
+    for (int i = 0; i < l->count; i++) {
+        // Skip PIDs that exited and were handed to some other process meanwhile
+        char comm[16];
+        read_comm(l->pids[i], comm, sizeof(comm));
+        if (strcmp(comm, l->names[i]) == 0) kill(l->pids[i], SIGCONT);
+    }
+    l->count = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef TRIMUI_LAUNCHER_H
+#define TRIMUI_LAUNCHER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LAUNCHER_MAX_PIDS 8
+#define LAUNCHER_WAIT_US  50000     // give up waiting for a stop after this long
+
+/* Suspends the stock launcher while the app owns the screen and input
+ *
+ * /proc is scanned once for the known launcher binaries; their PIDs are
+ * cached and signalled directly, instead of a shell running killall for
+ * each name on both start and exit. launcher_suspend() only returns once
+ * every launcher is actually stopped (or the wait times out), so it cannot
+ * draw over the first frame.
+ */
+typedef struct {
+    pid_t pids[LAUNCHER_MAX_PIDS];
+    char names[LAUNCHER_MAX_PIDS][16];  // comm, to spot a recycled PID on resume
+    int count;
+    uint32_t wait_us;                   // how long suspend waited for the stops
+} Launcher;
+
+/* Find and SIGSTOP the launchers; returns how many were stopped */
+int launcher_suspend(Launcher *l);
+
+/* SIGCONT whatever launcher_suspend() stopped */
+void launcher_resume(Launcher *l);
+
+#endif
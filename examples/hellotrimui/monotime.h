@@ -0,0 +1,20 @@
+#ifndef TRIMUI_MONOTIME_H
+#define TRIMUI_MONOTIME_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+
+/* CLOCK_MONOTONIC in microseconds, the time base shared by all modules */
+static inline uint64_t monotime_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+/* Convert an input_event timestamp (see EVIOCSCLOCKID) to microseconds */
+static inline uint64_t timeval_us(const struct timeval *tv) {
+    return (uint64_t)tv->tv_sec * 1000000u + tv->tv_usec;
+}
+
+#endif
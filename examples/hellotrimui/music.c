@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "music.h"
+#include "monotime.h"
+
+const int16_t ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+const int8_t ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+#define WAV_FORMAT_IMA_ADPCM 0x0011
+
+int ima_decode_block(int16_t *out, const uint8_t *block, int bytes) {
+    if (bytes < 4) return 0;
+    ImaState s;
+    s.predictor = (int16_t)(block[0] | block[1] << 8);
+    s.index = block[2] > 88 ? 88 : block[2];
+
+    // Codes are packed low nibble first
+    int16_t *o = out;
+    *o++ = (int16_t)s.predictor;
+    for (int i = 4; i < bytes; i++) {
+        uint8_t b = block[i];
+        *o++ = (int16_t)ima_decode_nibble(&s, b & 15);
+        *o++ = (int16_t)ima_decode_nibble(&s, b >> 4);
+    }
+    return (int)(o - out);
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int read_at(int fd, void *buf, int len, off_t off) {
+    uint8_t *p = buf;
+    int done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, p + done, len - done, off + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        done += n;
+    }
+    return done;
+}
+
+/* Walk the RIFF chunks for fmt, fact and data; returns 0 or -1 */
+static int parse_wav(Music *m, int rate) {
+    struct stat st;
+    uint8_t h[20];
+    if (fstat(m->fd, &st) < 0) return -1;
+    if (read_at(m->fd, h, 12, 0) != 12 || memcmp(h, "RIFF", 4) || memcmp(h + 8, "WAVE", 4)) goto bad;
+
+    int have_fmt = 0, have_data = 0;
+    for (off_t off = 12; !have_data && off + 8 <= st.st_size;) {
+        if (read_at(m->fd, h, 8, off) != 8) goto bad;
+        uint32_t size = le32(h + 4);
+        off_t body = off + 8;
+
+        if (!memcmp(h, "fmt ", 4)) {
+            if (size < 16 || read_at(m->fd, h, 16, body) != 16) goto bad;
+            int format = h[0] | h[1] << 8, channels = h[2] | h[3] << 8;
+            int bits = h[14] | h[15] << 8;
+            if (format != WAV_FORMAT_IMA_ADPCM || channels != 1 || bits != 4 ||
+                (int)le32(h + 4) != rate) {
+                goto bad;
+            }
+            m->block_align = h[12] | h[13] << 8;
+            have_fmt = 1;
+        } else if (!memcmp(h, "fact", 4) && size >= 4) {
+            if (read_at(m->fd, h, 4, body) != 4) goto bad;
+            m->total_samples = le32(h);
+        } else if (!memcmp(h, "data", 4)) {
+            // A file written by a streaming encoder may not have its size patched
+            m->data_offset = (uint32_t)body;
+            m->data_bytes = size;
+            if (body + size > st.st_size || size == 0) m->data_bytes = (uint32_t)(st.st_size - body);
+            have_data = 1;
+        }
+        off = body + size + (size & 1);
+    }
+    if (!have_fmt || !have_data) goto bad;
+
+    // A block plus its header must fit one decode buffer and one read
+    m->block_samples = (m->block_align - 4) * 2 + 1;
+    if (m->block_align < 5 || m->block_samples > MUSIC_BUFFER_SAMPLES) goto bad;
+    return 0;
+
+bad:
+    errno = EINVAL;
+    return -1;
+}
+
+/* Next block of the file, refilling the chunk when it runs out; returns
+ * its length, 0 at the end of the data or -1 on a read error
+ */
+static int next_block(Music *m, const uint8_t **block, uint32_t *read_us) {
+    if (m->chunk_pos >= m->chunk_len) {
+        uint32_t left = m->data_bytes - m->file_pos;
+        if (left == 0) return 0;
+
+        int cap = MUSIC_CHUNK_BYTES - MUSIC_CHUNK_BYTES % m->block_align;
+        int len = left < (uint32_t)cap ? (int)left : cap;
+        off_t off = (off_t)m->data_offset + m->file_pos;
+        uint64_t t0 = monotime_us();
+        int got = read_at(m->fd, m->chunk, len, off);
+        if (got <= 0) return -1;
+
+        // Have the kernel fetch the next chunk (or, when looping, the first
+        // one again) while this one is being decoded
+        if (m->file_pos + got < m->data_bytes) {
+            posix_fadvise(m->fd, off + got, cap, POSIX_FADV_WILLNEED);
+        } else if (m->loop) {
+            posix_fadvise(m->fd, m->data_offset, cap, POSIX_FADV_WILLNEED);
+        }
+
+        uint32_t us = (uint32_t)(monotime_us() - t0);
+        *read_us += us;
+        if (us > m->read_max_us) m->read_max_us = us;
+        m->file_pos += got;
+        m->chunk_len = got;
+        m->chunk_pos = 0;
+    }
+
+    int len = m->chunk_len - m->chunk_pos;
+    if (len > m->block_align) len = m->block_align;
+    *block = m->chunk + m->chunk_pos;
+    m->chunk_pos += len;
+    return len;
+}
+
+/* Decode whole blocks into the ring, up to MUSIC_BUFFER_SAMPLES; the caller
+ * has checked that there is room
+ */
+static void decode_buffer(Music *m) {
+    uint64_t t0 = monotime_us();
+    uint32_t read_us = 0;
+    int n = 0;
+
+    while (n + m->block_samples <= MUSIC_BUFFER_SAMPLES) {
+        const uint8_t *block;
+        int len = next_block(m, &block, &read_us);
+        int got = len > 0 ? ima_decode_block(m->scratch + n, block, len) : 0;
+
+        // The last block is padded; the fact chunk has the real length
+        if (m->total_samples && m->samples_out + got > m->total_samples) {
+            got = (int)(m->total_samples - m->samples_out);
+            m->chunk_pos = m->chunk_len;
+            m->file_pos = m->data_bytes;
+        }
+        n += got;
+        m->samples_out += got;
+
+        if (len > 0 && got > 0) continue;
+        if (len < 0 || !m->loop || m->samples_out == 0) {
+            __atomic_store_n(&m->finished, 1, __ATOMIC_RELEASE);
+            break;
+        }
+        m->file_pos = 0;
+        m->chunk_pos = m->chunk_len = 0;
+        m->samples_out = 0;
+        m->loops++;
+    }
+
+    unsigned head = m->head;
+    unsigned at = head & (MUSIC_RING_SAMPLES - 1);
+    int first = MUSIC_RING_SAMPLES - at < (unsigned)n ? (int)(MUSIC_RING_SAMPLES - at) : n;
+    memcpy(m->ring + at, m->scratch, first * sizeof(int16_t));
+    memcpy(m->ring, m->scratch + first, (n - first) * sizeof(int16_t));
+    __atomic_store_n(&m->head, head + n, __ATOMIC_RELEASE);
+
+    uint32_t us = (uint32_t)(monotime_us() - t0) - read_us;
+    m->decode_last_us = us;
+    if (us > m->decode_max_us) m->decode_max_us = us;
+    m->decode_sum_us += us;
+    m->decoded += n;
+    m->buffers++;
+}
+
+static int ring_has_room(Music *m) {
+    unsigned tail = __atomic_load_n(&m->tail, __ATOMIC_ACQUIRE);
+    return MUSIC_RING_SAMPLES - (m->head - tail) >= MUSIC_BUFFER_SAMPLES;
+}
+
+static void *decoder_thread(void *arg) {
+    Music *m = arg;
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), MUSIC_NICE);
+
+    while (m->running) {
+        if (!m->finished && ring_has_room(m)) {
+            decode_buffer(m);
+            continue;
+        }
+        // Announce the wait before checking again, so a post from the
+        // mixer in between is not lost
+        __atomic_store_n(&m->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (m->running && !m->finished && ring_has_room(m)) {
+            __atomic_store_n(&m->sleeping, 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        while (sem_wait(&m->wake) < 0 && errno == EINTR) {}
+    }
+    return NULL;
+}
+
+int music_open(Music *m, const char *path, int rate, int loop) {
+    memset(m, 0, sizeof(*m));
+    m->rate = rate;
+    m->loop = loop;
+    m->volume = 256;
+
+    m->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (m->fd < 0) return -1;
+    if (parse_wav(m, rate) < 0) goto fail;
+    posix_fadvise(m->fd, m->data_offset, m->data_bytes, POSIX_FADV_SEQUENTIAL);
+
+    m->chunk = malloc(MUSIC_CHUNK_BYTES);
+    m->scratch = malloc(MUSIC_BUFFER_SAMPLES * sizeof(int16_t));
+    if (!m->chunk || !m->scratch) goto fail;
+
+    // Start with a full ring so the mixer has music from its first fragment
+    while (!m->finished && ring_has_room(m)) decode_buffer(m);
+
+    if (sem_init(&m->wake, 0, 0) < 0) goto fail;
+    m->running = 1;
+    if (pthread_create(&m->thread, NULL, decoder_thread, m) != 0) {
+        m->running = 0;
+        sem_destroy(&m->wake);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        music_close(m);
+        errno = saved;
+    }
+    return -1;
+}
+
+void music_close(Music *m) {
+    if (m->running) {
+        m->running = 0;
+        sem_post(&m->wake);
+        pthread_join(m->thread, NULL);
+        sem_destroy(&m->wake);
+    }
+    if (m->fd >= 0) close(m->fd);
+    m->fd = -1;
+    free(m->chunk);
+    free(m->scratch);
+    m->chunk = NULL;
+    m->scratch = NULL;
+}
+
+static void add_scaled(int32_t *acc, const int16_t *src, int n, int volume) {
+    if (volume == 256) {
+        for (int j = 0; j < n; j++) acc[j] += src[j];
+    } else {
+        for (int j = 0; j < n; j++) acc[j] += (src[j] * volume) >> 8;
+    }
+}
+
+int music_mix(Music *m, int32_t *acc, int samples) {
+    unsigned head = __atomic_load_n(&m->head, __ATOMIC_ACQUIRE);
+    unsigned tail = m->tail;
+    unsigned avail = head - tail;
+    int n = avail < (unsigned)samples ? (int)avail : samples;
+
+    unsigned at = tail & (MUSIC_RING_SAMPLES - 1);
+    int first = MUSIC_RING_SAMPLES - at < (unsigned)n ? (int)(MUSIC_RING_SAMPLES - at) : n;
+    add_scaled(acc, m->ring + at, first, m->volume);
+    add_scaled(acc + first, m->ring, n - first, m->volume);
+    __atomic_store_n(&m->tail, tail + n, __ATOMIC_RELEASE);
+
+    if (n < samples) {
+        if (__atomic_load_n(&m->finished, __ATOMIC_ACQUIRE)) return 0;
+        m->underruns++;
+    }
+    // Wake the decoder once half the ring has been played
+    if (avail - n < MUSIC_RING_SAMPLES / 2 && __atomic_exchange_n(&m->sleeping, 0, __ATOMIC_SEQ_CST)) {
+        sem_post(&m->wake);
+    }
+    return 1;
+}
+
+uint32_t music_cpu_centipct(const Music *m) {
+    if (!m->decoded) return 0;
+    // decode time / (decoded / rate seconds), in units of 0.01 %
+    return (uint32_t)(m->decode_sum_us * (uint64_t)m->rate / (m->decoded * 100));
+}
@@ -0,0 +1,115 @@
+#ifndef TRIMUI_MUSIC_H
+#define TRIMUI_MUSIC_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/* Music files are IMA-ADPCM WAVs (format tag 0x0011, mono), as written by
+ * tools/mkadpcm.c or `sox in.wav -e ima-adpcm out.wav`: 4 bits per sample,
+ * a quarter of the size of 16-bit PCM. Each block of `block_align` bytes
+ * starts with a 16-bit sample and a step index, so blocks decode on their
+ * own and the stream can loop or seek on any block boundary.
+ */
+#define MUSIC_RING_SAMPLES   16384   // decoded PCM waiting for the mixer (power of two)
+#define MUSIC_BUFFER_SAMPLES 2048    // decoded per wake-up: whole blocks, at most this many
+#define MUSIC_CHUNK_BYTES    16384   // file bytes per read(); the next chunk is read ahead
+#define MUSIC_NICE           5       // decoder thread priority, below the mixer and the UI
+
+/* Decoder state for one channel */
+typedef struct {
+    int predictor;      // last sample
+    int index;          // into ima_step_table, 0..88
+} ImaState;
+
+extern const int16_t ima_step_table[89];
+extern const int8_t ima_index_table[16];
+
+/* Decode one 4-bit code and return the new sample; integer only */
+static inline int ima_decode_nibble(ImaState *s, int code) {
+    int step = ima_step_table[s->index];
+    int diff = step >> 3;
+    if (code & 4) diff += step;
+    if (code & 2) diff += step >> 1;
+    if (code & 1) diff += step >> 2;
+
+    int p = s->predictor + (code & 8 ? -diff : diff);
+    if (p > 32767) p = 32767;
+    else if (p < -32768) p = -32768;
+    s->predictor = p;
+
+    int i = s->index + ima_index_table[code];
+    s->index = i < 0 ? 0 : i > 88 ? 88 : i;
+    return p;
+}
+
+/* Decode one mono block into `out`; returns the number of samples (at most
+ * 2 * (bytes - 4) + 1), 0 if the block is too short
+ */
+int ima_decode_block(int16_t *out, const uint8_t *block, int bytes);
+
+/* Streaming music player
+ *
+ * A decoder thread reads the file in MUSIC_CHUNK_BYTES pieces, asking the
+ * kernel for the following chunk while it decodes the current one, and
+ * keeps a single-producer/single-consumer ring of PCM topped up. The mixer
+ * thread pulls from the ring with music_mix() and wakes the decoder when the
+ * ring is half empty, so the decoder runs in short bursts a few times a
+ * second and never touches the SD card from the audio path.
+ */
+typedef struct {
+    int fd;
+    int rate;
+    int loop;
+    int volume;             // 0..256, read by the mixer
+
+    // File layout
+    int block_align;
+    int block_samples;      // samples in a full block
+    uint32_t data_offset;   // first block
+    uint32_t data_bytes;
+    uint32_t total_samples; // from the fact chunk, trims the last block; 0 = unknown
+
+    // Decoder thread only
+    uint8_t *chunk;         // MUSIC_CHUNK_BYTES read from the file
+    int chunk_len, chunk_pos;
+    uint32_t file_pos;      // offset of the next read, relative to data_offset
+    uint32_t samples_out;   // decoded since the start of this pass
+    int16_t *scratch;       // MUSIC_BUFFER_SAMPLES
+    int finished;           // end of a non-looping track (or a read error)
+
+    pthread_t thread;
+    volatile int running;
+    sem_t wake;             // posted by the mixer when the ring runs low
+    int sleeping;           // decoder is (about to be) waiting on `wake`
+
+    int16_t ring[MUSIC_RING_SAMPLES];
+    unsigned head;          // next sample to write, owned by the decoder
+    unsigned tail;          // next sample to read, owned by the mixer
+
+    // Statistics (underruns: by the mixer, the rest by the decoder)
+    uint32_t buffers;       // decode bursts
+    uint32_t decode_last_us;
+    uint32_t decode_max_us;
+    uint64_t decode_sum_us;
+    uint64_t decoded;       // samples, over all passes
+    uint32_t read_max_us;   // slowest read()
+    uint32_t loops;
+    uint32_t underruns;     // mixer calls that found the ring short
+} Music;
+
+/* Open an IMA-ADPCM WAV at `rate` Hz and start decoding; returns 0, or -1
+ * (errno EINVAL if the file is not a mono IMA-ADPCM WAV at that rate)
+ */
+int music_open(Music *m, const char *path, int rate, int loop);
+void music_close(Music *m);
+
+/* Mixer side: add `samples` samples scaled by m->volume into `acc`;
+ * returns 0 once a non-looping track has played out
+ */
+int music_mix(Music *m, int32_t *acc, int samples);
+
+/* Decoder time as a share of playback time, in hundredths of a percent */
+uint32_t music_cpu_centipct(const Music *m);
+
+#endif
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+void platform_init(Platform *p, const PlatformOps *ops, const PlatformConfig *cfg) {
+    memset(p, 0, sizeof(*p));
+    p->ops = ops;
+    p->cfg = *cfg;
+    hud_init(&p->hud);
+    const char *env = getenv("TRIMUI_HUD");
+    p->hud_at_start = env && *env && strcmp(env, "0") != 0;
+}
+
+/* Once a second while the HUD is up, even if the app itself is idle */
+static void hud_on_timer(int fd, void *user) {
+    Platform *p = user;
+    uint64_t expirations;
+    ssize_t n = read(fd, &expirations, sizeof(expirations));
+    (void)n;
+    hud_refresh(&p->hud, &p->loop->stats, p->audio);
+    runloop_mark_dirty(p->loop);
+}
+
+void platform_show_hud(Platform *p, int visible) {
+    Hud *h = &p->hud;
+    if (!p->surf || !p->loop || !visible == !h->visible) return;
+
+    if (h->timer_fd >= 0) runloop_remove_fd(p->loop, h->timer_fd);
+    if (hud_show(h, p->surf, visible) < 0) return;
+    if (h->visible) runloop_add_fd(p->loop, h->timer_fd, hud_on_timer, p);
+    runloop_mark_dirty(p->loop);
+}
+
+void platform_close_hud(Platform *p) {
+    if (p->loop && p->hud.timer_fd >= 0) runloop_remove_fd(p->loop, p->hud.timer_fd);
+    hud_free(&p->hud);
+}
+
+void platform_input(Platform *p, const struct input_event *ev, int count) {
+    // Events the HUD swallows split the batch; the rest reaches the app in order
+    int first = 0;
+    for (int i = 0; i < count; i++) {
+        HudEvent e = hud_feed(&p->hud, &ev[i]);
+        if (e == HUD_PASS) continue;
+        if (i > first) p->on_events(ev + first, i - first, p->user);
+        first = i + 1;
+        if (e == HUD_TOGGLE) platform_show_hud(p, !p->hud.visible);
+    }
+    if (count > first) p->on_events(ev + first, count - first, p->user);
+}
+
+void platform_present(Platform *p) {
+    Surface *s = p->surf;
+    if (p->hud_at_start && p->loop) {
+        p->hud_at_start = 0;
+        platform_show_hud(p, 1);
+    }
+    if (p->capture_state == 0) {
+        p->capture_state = p->cfg.capture_path &&
+            capture_open(&p->capture, p->cfg.capture_path, s->back.width, s->back.height) == 0 ? 1 : -1;
+    }
+
+    hud_draw(&p->hud, s);
+    surface_flush(s);
+    if (p->ops->present) p->ops->present(p);
+
+    // The back buffer now matches the screen, HUD included; copying it costs
+    // one memcpy per row here, everything else happens on the writer thread
+    if (p->capture_state == 1) capture_frame(&p->capture, &s->back);
+    hud_restore(&p->hud, s);
+}
+
+void platform_close_capture(Platform *p) {
+    if (p->capture_state != 1) return;
+    capture_close(&p->capture);
+    p->capture_state = -1;
+    Capture *c = &p->capture;
+    fprintf(stderr, "capture: %u frames written, %u dropped, %llu bytes (%llu raw)\n",
+            c->frames_written, c->dropped, (unsigned long long)c->bytes_written,
+            (unsigned long long)c->raw_bytes);
+}
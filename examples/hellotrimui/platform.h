@@ -0,0 +1,108 @@
+#ifndef TRIMUI_PLATFORM_H
+#define TRIMUI_PLATFORM_H
+
+#include "surface.h"
+#include "audio.h"
+#include "runloop.h"
+#include "evdev.h"
+#include "evlog.h"
+#include "launcher.h"
+#include "hud.h"
+#include "capture.h"
+
+/* Options from the command line; backends ignore the ones they do not use */
+typedef struct {
+    const char *record_path;    // fbdev: log every input event here
+    const char *replay_path;    // headless: input log to replay (none = quit at once)
+    const char *ppm_path;       // headless: final frame, or every frame if it has a %d
+    const char *wav_path;       // headless: mixed audio (none = null sink)
+    const char *capture_path;   // record every presented frame here (tools/capdump.c)
+    int width, height;          // headless framebuffer size
+} PlatformConfig;
+
+typedef struct Platform Platform;
+
+/* Backend entry points, called in this order by main()
+ * enter/present/leave may be NULL.
+ */
+typedef struct {
+    const char *name;
+    void (*enter)(Platform *p);                     // before anything is opened
+    int (*open_video)(Platform *p, Surface *s);
+    int (*open_audio)(Platform *p, Audio *a);
+    int (*start_input)(Platform *p, RunLoop *rl);   // register input fds with the loop
+    void (*present)(Platform *p);                   // after every flush, from platform_present()
+    void (*stop_input)(Platform *p);
+    void (*leave)(Platform *p);                     // before the surface is closed
+} PlatformOps;
+
+/* Where frames, sound and input come from
+ *
+ * The fbdev backend is the device itself: /dev/fb0, /dev/input/event*
+ * through the evdev manager, and OSS. The headless backend runs the same
+ * app on any Linux box: a memory framebuffer saved as PPM, input replayed
+ * from an event log, and a WAV file or null audio sink. Input reaches the
+ * app through the same batch callback either way.
+ */
+struct Platform {
+    const PlatformOps *ops;
+    PlatformConfig cfg;
+
+    Surface *surf;
+    RunLoop *loop;
+    const int *codes;           // key codes input devices must report
+    int num_codes;
+    EvdevEventsFn on_events;
+    void *user;
+    int monotonic;              // input is stamped with CLOCK_MONOTONIC
+    Audio *audio;               // once open_audio() succeeded, for the HUD
+
+    Hud hud;                    // performance overlay, toggled with SELECT + R
+    int hud_at_start;           // TRIMUI_HUD is set: show it from the first frame
+    Capture capture;            // --capture, opened on the first present
+    int capture_state;          // 0 = not yet, 1 = recording, -1 = off or failed
+
+    EvdevManager evdev;         // fbdev
+    Launcher launcher;          // fbdev, suspended while we own the screen
+    EvlogWriter record;         // fbdev, --record
+    EvlogReader replay;         // headless
+    uint32_t frames_saved;      // headless, per-frame PPM dumps
+};
+
+void platform_fbdev(Platform *p, const PlatformConfig *cfg);
+void platform_headless(Platform *p, const PlatformConfig *cfg);
+
+/* Shared by the backends (platform.c) */
+
+/* Reset the fields every backend has; called first by platform_fbdev() etc. */
+void platform_init(Platform *p, const PlatformOps *ops, const PlatformConfig *cfg);
+
+/* Pass an input batch to the app, minus the events of the HUD combo */
+void platform_input(Platform *p, const struct input_event *ev, int count);
+
+/* Show or hide the performance HUD */
+void platform_show_hud(Platform *p, int visible);
+void platform_close_hud(Platform *p);
+
+/* Push the frame: draw the HUD, surface_flush(), the backend's present,
+ * then queue the frame for --capture
+ */
+void platform_present(Platform *p);
+
+/* Finish the capture file; called by the backends' leave() */
+void platform_close_capture(Platform *p);
+
+/* Input goes to `on_events`; only the buttons in `codes` are of interest.
+ * `in` is the app's button map, which the HUD combo is resolved through
+ * (NULL = the default layout).
+ */
+static inline void platform_set_input(Platform *p, const InputState *in, const int *codes,
+                                      int num_codes, EvdevEventsFn on_events, void *user) {
+    p->hud.input = in;
+    p->codes = codes;
+    p->num_codes = num_codes;
+    p->on_events = on_events;
+    p->user = user;
+}
+
+#endif
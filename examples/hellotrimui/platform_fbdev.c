@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+
+#include "platform.h"
+
+static void fbdev_enter(Platform *p) {
+    (void)p;
+
+    // Redirect stdio to prevent launcher interference
+    FILE *f_stdin = freopen("/dev/null", "r", stdin);
+    FILE *f_stdout = freopen("/dev/null", "w", stdout);
+    FILE *f_stderr = freopen("/dev/null", "w", stderr);
+    (void)f_stdin; (void)f_stdout; (void)f_stderr;
+
+    // Ignore signals that might be sent by the launcher
+    signal(SIGTERM, SIG_IGN);
+    signal(SIGINT, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGTSTP, SIG_IGN);
+    signal(SIGCONT, SIG_IGN);
+
+    // Try to take control of the console
+    int console = open("/dev/console", O_RDWR);
+    if (console >= 0) {
+        // Successfully opened console
+        (void)console; // Keep it open
+    }
+
+    // Detach from parent process
+    setsid();
+}
+
+static int fbdev_open_video(Platform *p, Surface *s) {
+    // Open framebuffer device and its off-screen back buffer
+    if (surface_open(s, "/dev/fb0") < 0) return -1;
+    p->surf = s;
+
+    // Suspend the launcher so we can take over the screen and input
+    // Returns once it is really stopped, so it cannot draw over our first frame
+    launcher_suspend(&p->launcher);
+    return 0;
+}
+
+static int fbdev_open_audio(Platform *p, Audio *a) {
+    if (audio_open(a, "/dev/dsp") < 0) return -1;
+    p->audio = a;
+    return 0;
+}
+
+/* Evdev batches pass through here so they can be logged for replay */
+static void fbdev_on_events(const struct input_event *ev, int count, void *user) {
+    Platform *p = user;
+    p->monotonic = p->evdev.monotonic;
+    evlog_write(&p->record, ev, count);
+    platform_input(p, ev, count);
+}
+
+/* Keep the run loop's fd set in step with hotplug */
+static void fbdev_on_device(int fd, int added, void *user) {
+    Platform *p = user;
+    if (added) runloop_add_fd(p->loop, fd, evdev_on_readable, &p->evdev);
+    else       runloop_remove_fd(p->loop, fd);
+}
+
+static int fbdev_start_input(Platform *p, RunLoop *rl) {
+    p->loop = rl;
+    if (p->cfg.record_path) evlog_writer_open(&p->record, p->cfg.record_path);
+
+    // Open only input devices that report our buttons, and follow hotplug
+    // Each device fd is registered with the run loop from fbdev_on_device()
+    if (evdev_init(&p->evdev, p->codes, p->num_codes, 0,
+                   fbdev_on_events, fbdev_on_device, p) < 0) {
+        return -1;
+    }
+    if (p->evdev.inotify_fd >= 0) {
+        runloop_add_fd(rl, p->evdev.inotify_fd, evdev_on_hotplug, &p->evdev);
+    }
+    evdev_scan(&p->evdev);
+    p->monotonic = p->evdev.monotonic;
+    return 0;
+}
+
+static void fbdev_stop_input(Platform *p) {
+    platform_close_hud(p);
+    evdev_free(&p->evdev);
+    evlog_writer_close(&p->record);
+}
+
+static void fbdev_leave(Platform *p) {
+    platform_close_capture(p);
+    // Resume launcher processes before exiting
+    launcher_resume(&p->launcher);
+}
+
+static const PlatformOps fbdev_ops = {
+    .name = "fbdev",
+    .enter = fbdev_enter,
+    .open_video = fbdev_open_video,
+    .open_audio = fbdev_open_audio,
+    .start_input = fbdev_start_input,
+    .present = NULL,
+    .stop_input = fbdev_stop_input,
+    .leave = fbdev_leave,
+};
+
+void platform_fbdev(Platform *p, const PlatformConfig *cfg) {
+    platform_init(p, &fbdev_ops, cfg);
+    p->evdev.inotify_fd = -1;
+}
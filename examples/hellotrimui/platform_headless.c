@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+
+static int headless_open_video(Platform *p, Surface *s) {
+    // Two pages, so flushes take the same page-flip path as on the device
+    if (surface_open_memory(s, p->cfg.width, p->cfg.height, 2) < 0) return -1;
+    p->surf = s;
+    return 0;
+}
+
+static int headless_open_audio(Platform *p, Audio *a) {
+    if (audio_open_wav(a, p->cfg.wav_path) < 0) return -1;
+    p->audio = a;
+    return 0;
+}
+
+static void headless_on_events(const struct input_event *ev, int count, void *user) {
+    Platform *p = user;
+    platform_input(p, ev, count);
+}
+
+/* The replay is over: let the last frame go out, then stop */
+static void headless_on_done(void *user) {
+    Platform *p = user;
+    runloop_quit(p->loop);
+}
+
+static int headless_start_input(Platform *p, RunLoop *rl) {
+    p->loop = rl;
+    p->monotonic = 1;   // replayed events are rebased onto monotime_us()
+    if (evlog_reader_open(&p->replay, p->cfg.replay_path,
+                          headless_on_events, headless_on_done, p) < 0) {
+        return -1;
+    }
+    runloop_add_fd(rl, p->replay.timer_fd, evlog_on_timer, &p->replay);
+    evlog_reader_start(&p->replay);
+    return 0;
+}
+
+/* Offset of the frame number in a --ppm path: its only "%d", and no other
+ * '%' anywhere; -1 for a plain path, which saves the final frame only
+ */
+static int frame_number_at(const char *path) {
+    const char *d = path ? strstr(path, "%d") : NULL;
+    if (!d) return -1;
+    for (const char *c = path; *c; c++) {
+        if (*c == '%' && c != d) return -1;
+    }
+    return (int)(d - path);
+}
+
+/* With a %d in the path every presented frame gets its own file */
+static void headless_present(Platform *p) {
+    const char *path = p->cfg.ppm_path;
+    int at = frame_number_at(path);
+    if (at < 0) return;
+
+    // The path is never used as a format string
+    char name[256];
+    snprintf(name, sizeof(name), "%.*s%d%s", at, path, (int)p->frames_saved++, path + at + 2);
+    surface_write_ppm(p->surf, name);
+}
+
+static void headless_stop_input(Platform *p) {
+    platform_close_hud(p);
+    if (p->loop) runloop_remove_fd(p->loop, p->replay.timer_fd);
+    evlog_reader_close(&p->replay);
+}
+
+static void headless_leave(Platform *p) {
+    Surface *s = p->surf;
+    platform_close_capture(p);
+    if (!s) return;     // the video never opened
+    if (p->cfg.ppm_path && frame_number_at(p->cfg.ppm_path) < 0) {
+        surface_write_ppm(s, p->cfg.ppm_path);
+    }
+    fprintf(stderr, "headless: %u frames, %llu bytes flushed\n",
+            s->frames, (unsigned long long)s->bytes_total);
+}
+
+static const PlatformOps headless_ops = {
+    .name = "headless",
+    .enter = NULL,
+    .open_video = headless_open_video,
+    .open_audio = headless_open_audio,
+    .start_input = headless_start_input,
+    .present = headless_present,
+    .stop_input = headless_stop_input,
+    .leave = headless_leave,
+};
+
+void platform_headless(Platform *p, const PlatformConfig *cfg) {
+    platform_init(p, &headless_ops, cfg);
+    if (p->cfg.width <= 0)  p->cfg.width = 320;
+    if (p->cfg.height <= 0) p->cfg.height = 240;
+    p->replay.timer_fd = -1;
+}
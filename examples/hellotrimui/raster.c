@@ -0,0 +1,265 @@
+#include "raster.h"
+#include "gfx.h"
+
+/* Pixels x0..x1 (included, x0 <= x1) of row y, clipped; returns 1 if any
+ * were drawn
+ */
+static inline int span(Canvas *dst, int x0, int x1, int y, uint16_t color) {
+    if ((unsigned)y >= (unsigned)dst->height) return 0;
+    if (x0 < 0) x0 = 0;
+    if (x1 >= dst->width) x1 = dst->width - 1;
+    if (x0 > x1) return 0;
+
+    uint16_t *row = (uint16_t *)(dst->pixels + y * dst->stride) + x0;
+    if (x0 == x1) *row = color;     // steep lines and outlines: no call
+    else gfx_fill_span(row, x1 - x0 + 1, color);
+    return 1;
+}
+
+int raster_hline(Canvas *dst, int x0, int x1, int y, uint16_t color) {
+    return x0 <= x1 ? span(dst, x0, x1, y, color) : span(dst, x1, x0, y, color);
+}
+
+/* a / b rounded down, b > 0; ARMv5 has no divide instruction, and the 32-bit
+ * library call is much cheaper than the 64-bit one
+ */
+static int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a == (int32_t)a && b == (int32_t)b ? (int32_t)a / (int32_t)b : a / b;
+    return q * b > a ? q - 1 : q;
+}
+
+/* The minor coordinate after k steps along the major axis is
+ * floor((2 * minor * k + major) / (2 * major)), the nearest pixel with ties
+ * rounded away from the start. The error term of that division is what the
+ * loops below carry, so a clipped line starts at its first visible pixel
+ * with one division instead of stepping there.
+ */
+
+/* |dx| >= |dy|: one span per row */
+static int line_shallow(Canvas *dst, int x0, int y0, int x1, int y1, uint16_t color) {
+    if (x0 > x1) {
+        int t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    int adx = x1 - x0, ady = y1 > y0 ? y1 - y0 : y0 - y1;
+    int sy = y1 < y0 ? -1 : 1;
+
+    int kmin = x0 < 0 ? -x0 : 0;
+    int kmax = x1 >= dst->width ? dst->width - 1 - x0 : adx;
+    if (kmin > kmax || adx == 0) return adx == 0 ? span(dst, x0, x0, y0, color) : 0;
+
+    int den = 2 * adx;
+    int64_t num = 2 * (int64_t)ady * kmin + adx;
+    int m = (int)floor_div(num, den);
+    int y = y0 + sy * m;
+    int err = (int)(num - (int64_t)m * den);
+
+    int spans = 0;
+    int x = x0 + kmin, end = x0 + kmax, start = x;
+    for (;;) {
+        err += 2 * ady;
+        int carry = err >= den;
+        if (carry || x == end) {
+            spans += span(dst, start, x, y, color);
+            if (x == end) break;
+            err -= den;
+            y += sy;
+            if (sy > 0 ? y >= dst->height : y < 0) break;
+            start = x + 1;
+        }
+        x++;
+    }
+    return spans;
+}
+
+/* |dy| > |dx|: one pixel per row */
+static int line_steep(Canvas *dst, int x0, int y0, int x1, int y1, uint16_t color) {
+    if (y0 > y1) {
+        int t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    int ady = y1 - y0, adx = x1 > x0 ? x1 - x0 : x0 - x1;
+    int sx = x1 < x0 ? -1 : 1;
+
+    int kmin = y0 < 0 ? -y0 : 0;
+    int kmax = y1 >= dst->height ? dst->height - 1 - y0 : ady;
+    if (kmin > kmax) return 0;
+
+    int den = 2 * ady;
+    int64_t num = 2 * (int64_t)adx * kmin + ady;
+    int m = (int)floor_div(num, den);
+    int x = x0 + sx * m;
+    int err = (int)(num - (int64_t)m * den);
+
+    int spans = 0;
+    for (int y = y0 + kmin, end = y0 + kmax; y <= end; y++) {
+        if ((unsigned)x < (unsigned)dst->width) {
+            *((uint16_t *)(dst->pixels + y * dst->stride) + x) = color;
+            spans++;
+        } else if (sx > 0 ? x >= dst->width : x < 0) {
+            break;      // left the canvas for good
+        }
+        err += 2 * adx;
+        if (err >= den) {
+            err -= den;
+            x += sx;
+        }
+    }
+    return spans;
+}
+
+int raster_line(Canvas *dst, int x0, int y0, int x1, int y1, uint16_t color) {
+    if (y0 == y1) return raster_hline(dst, x0, x1, y0, color);
+    int adx = x1 > x0 ? x1 - x0 : x0 - x1;
+    int ady = y1 > y0 ? y1 - y0 : y0 - y1;
+    if (adx >= ady) return line_shallow(dst, x0, y0, x1, y1, color);
+    return line_steep(dst, x0, y0, x1, y1, color);
+}
+
+/* Rows cy - dy and cy + dy (once when dy is 0) */
+static int span_pair(Canvas *dst, int x0, int x1, int cy, int dy, uint16_t color) {
+    int n = span(dst, x0, x1, cy + dy, color);
+    if (dy) n += span(dst, x0, x1, cy - dy, color);
+    return n;
+}
+
+int raster_circle(Canvas *dst, int cx, int cy, int r, uint16_t color, int fill) {
+    if (r < 0 || cx + r < 0 || cy + r < 0 || cx - r >= dst->width || cy - r >= dst->height) {
+        return 0;
+    }
+
+    // One octant of (x, y) points, x rising from 0 and y falling from r;
+    // rows cy +/- y get runs of x (closed when y steps), rows cy +/- x the
+    // points at +/- y. The point where x == y belongs to the runs.
+    int spans = 0;
+    int x = 0, y = r, d = 1 - r;
+    int run = 0;        // first x of the run on rows cy +/- y
+    while (x <= y) {
+        if (x < y) {
+            if (fill) {
+                spans += span_pair(dst, cx - y, cx + y, cy, x, color);
+            } else {
+                spans += span_pair(dst, cx - y, cx - y, cy, x, color);
+                spans += span_pair(dst, cx + y, cx + y, cy, x, color);
+            }
+        }
+
+        int step_y = d >= 0;
+        if (step_y || x + 1 > y) {
+            // Close the run on rows cy +/- y
+            if (fill || run == 0) {
+                spans += span_pair(dst, cx - x, cx + x, cy, y, color);
+            } else {
+                spans += span_pair(dst, cx - x, cx - run, cy, y, color);
+                spans += span_pair(dst, cx + run, cx + x, cy, y, color);
+            }
+            run = x + 1;
+        }
+        if (step_y) {
+            d += 2 * (x - y) + 5;
+            y--;
+        } else {
+            d += 2 * x + 3;
+        }
+        x++;
+    }
+    return spans;
+}
+
+/* One polygon edge, walked a row at a time
+ *
+ * On row y the edge crosses the pixel-centre line at X = x0 + (y + 1/2 - y0)
+ * * dx / dy. The first pixel whose centre is right of the crossing is
+ * ceil(X - 1/2) = ceil(N / den) with den = 2 dy; `col` is that pixel and
+ * `err` = col * den - N, so moving down a row (N += 2 dx) needs only an add
+ * and a compare.
+ */
+typedef struct {
+    int y_top, y_end;       // rows covered: y_top <= y < y_end
+    int x0, y0, dx, dy;     // top vertex and direction, dy > 0
+    int col, err;
+    int step, rem;          // 2 dx = step * den + rem, 0 <= rem < den
+} RasterEdge;
+
+/* Position the edge on row y */
+static void edge_start(RasterEdge *e, int y) {
+    int den = 2 * e->dy;
+    int64_t num = (int64_t)(2 * e->x0 - 1) * e->dy + (int64_t)(2 * (y - e->y0) + 1) * e->dx;
+    int64_t col = floor_div(num + den - 1, den);
+    e->col = (int)col;
+    e->err = (int)(col * den - num);
+    e->step = (int)floor_div(2 * (int64_t)e->dx, den);
+    e->rem = 2 * e->dx - e->step * den;
+}
+
+static inline void edge_next(RasterEdge *e) {
+    e->col += e->step;
+    e->err -= e->rem;
+    if (e->err < 0) {
+        e->err += 2 * e->dy;
+        e->col++;
+    }
+}
+
+int raster_polygon(Canvas *dst, const RasterPoint *pts, int n, uint16_t color) {
+    if (n > RASTER_MAX_POINTS) return -1;
+
+    // Edge table: non-horizontal edges, sorted by their first row
+    RasterEdge edges[RASTER_MAX_POINTS];
+    int num = 0;
+    int y_min = dst->height, y_max = 0;
+    int x_min = dst->width, x_max = -1;
+    for (int i = 0; i < n; i++) {
+        const RasterPoint *a = &pts[i], *b = &pts[i + 1 < n ? i + 1 : 0];
+        if (a->x < x_min) x_min = a->x;
+        if (a->x > x_max) x_max = a->x;
+        if (a->y == b->y) continue;
+        if (a->y > b->y) {
+            const RasterPoint *t = a; a = b; b = t;
+        }
+        RasterEdge e = { a->y, b->y, a->x, a->y, b->x - a->x, b->y - a->y, 0, 0, 0, 0 };
+        int j = num++;
+        for (; j > 0 && edges[j - 1].y_top > e.y_top; j--) edges[j] = edges[j - 1];
+        edges[j] = e;
+        if (a->y < y_min) y_min = a->y;
+        if (b->y > y_max) y_max = b->y;
+    }
+    if (x_max < 0 || x_min >= dst->width) return 0;
+    if (y_min < 0) y_min = 0;
+    if (y_max > dst->height) y_max = dst->height;
+
+    // Active edges, kept sorted by column; they move little from row to row,
+    // so an insertion sort is close to one pass
+    RasterEdge *active[RASTER_MAX_POINTS];
+    int num_active = 0, next = 0;
+    int spans = 0;
+    for (int y = y_min; y < y_max; y++) {
+        while (next < num && edges[next].y_top <= y) {
+            RasterEdge *e = &edges[next++];
+            if (e->y_end <= y) continue;
+            edge_start(e, y);
+            active[num_active++] = e;
+        }
+        int kept = 0;
+        for (int i = 0; i < num_active; i++) {
+            if (active[i]->y_end > y) active[kept++] = active[i];
+        }
+        num_active = kept;
+
+        for (int i = 1; i < num_active; i++) {
+            RasterEdge *e = active[i];
+            int j = i;
+            for (; j > 0 && active[j - 1]->col > e->col; j--) active[j] = active[j - 1];
+            active[j] = e;
+        }
+
+        // Even-odd: inside between each pair of crossings
+        for (int i = 0; i + 1 < num_active; i += 2) {
+            if (active[i]->col < active[i + 1]->col) {
+                spans += span(dst, active[i]->col, active[i + 1]->col - 1, y, color);
+            }
+        }
+        for (int i = 0; i < num_active; i++) edge_next(active[i]);
+    }
+    return spans;
+}
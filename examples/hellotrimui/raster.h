@@ -0,0 +1,44 @@
+#ifndef TRIMUI_RASTER_H
+#define TRIMUI_RASTER_H
+
+#include <stdint.h>
+
+#include "surface.h"
+
+#define RASTER_MAX_POINTS 256   // polygon vertices per call
+
+typedef struct {
+    int x, y;
+} RasterPoint;
+
+/* Integer 2D shapes drawn as horizontal spans
+ *
+ * Every shape is broken into runs of pixels on one row, and each run is
+ * clipped against the canvas (the screen size the framebuffer reported)
+ * and written with gfx_fill_span(), the same word-store path as gfx_fill().
+ * Nothing is tested per pixel and there is no floating point. Coordinates
+ * may lie far outside the canvas, up to +/-2^28.
+ *
+ * Every call returns the number of spans it wrote, for benchmarking.
+ */
+
+/* Row y from x0 to x1, both included, in either order */
+int raster_hline(Canvas *dst, int x0, int x1, int y, uint16_t color);
+
+/* Bresenham line including both end points; the pixels do not depend on
+ * which end comes first. Each row of a shallow line is one span.
+ */
+int raster_line(Canvas *dst, int x0, int y0, int x1, int y1, uint16_t color);
+
+/* Midpoint circle outline, or the whole disc when `fill` is set */
+int raster_circle(Canvas *dst, int cx, int cy, int r, uint16_t color, int fill);
+
+/* Filled polygon, convex or concave (even-odd rule), closed implicitly
+ *
+ * Pixels are filled when their centre is inside, so polygons sharing an
+ * edge neither overlap nor leave a gap. Returns -1 if `n` is more than
+ * RASTER_MAX_POINTS.
+ */
+int raster_polygon(Canvas *dst, const RasterPoint *pts, int n, uint16_t color);
+
+#endif
@@ -0,0 +1,168 @@
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/timerfd.h>
+
+#include "runloop.h"
+#include "monotime.h"
+
+/* Length of a stats reporting window */
+#define STATS_WINDOW_US 1000000u
+
+static void set_timer(RunLoop *rl, int armed) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (armed) {
+        its.it_value.tv_nsec = 1;   // first tick right away
+        its.it_interval.tv_sec = rl->frame_us / 1000000u;
+        its.it_interval.tv_nsec = (rl->frame_us % 1000000u) * 1000;
+    }
+    timerfd_settime(rl->timer_fd, 0, &its, NULL);
+    rl->timer_armed = armed;
+}
+
+int runloop_init(RunLoop *rl, int fps) {
+    memset(rl, 0, sizeof(*rl));
+    if (fps <= 0) fps = 60;
+    rl->frame_us = 1000000u / fps;
+
+    rl->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (rl->timer_fd < 0) return -1;
+
+    rl->pfds[0].fd = rl->timer_fd;
+    rl->pfds[0].events = POLLIN;
+    rl->nfds = 1;
+    return 0;
+}
+
+void runloop_free(RunLoop *rl) {
+    if (rl->timer_fd >= 0) close(rl->timer_fd);
+    rl->timer_fd = -1;
+}
+
+int runloop_add_fd(RunLoop *rl, int fd, RunLoopFdFn fn, void *user) {
+    if (rl->nfds == RUNLOOP_MAX_FDS + 1) return -1;
+    rl->pfds[rl->nfds].fd = fd;
+    rl->pfds[rl->nfds].events = POLLIN;
+    rl->pfds[rl->nfds].revents = 0;
+    rl->fns[rl->nfds] = fn;
+    rl->users[rl->nfds] = user;
+    rl->nfds++;
+    return 0;
+}
+
+void runloop_remove_fd(RunLoop *rl, int fd) {
+    // poll() skips negative fds; the slot is compacted before the next poll
+    for (int i = 1; i < rl->nfds; i++) {
+        if (rl->pfds[i].fd == fd) {
+            rl->pfds[i].fd = -1;
+            rl->removed = 1;
+        }
+    }
+}
+
+static void compact(RunLoop *rl) {
+    int n = 1;
+    for (int i = 1; i < rl->nfds; i++) {
+        if (rl->pfds[i].fd < 0) continue;
+        rl->pfds[n] = rl->pfds[i];
+        rl->fns[n] = rl->fns[i];
+        rl->users[n] = rl->users[i];
+        n++;
+    }
+    rl->nfds = n;
+    rl->removed = 0;
+}
+
+void runloop_set_frame(RunLoop *rl, RunLoopFrameFn fn, void *user) {
+    rl->on_frame = fn;
+    rl->frame_user = user;
+}
+
+void runloop_set_stats(RunLoop *rl, RunLoopStatsFn fn, void *user) {
+    rl->on_stats = fn;
+    rl->stats_user = user;
+}
+
+void runloop_mark_dirty(RunLoop *rl) {
+    rl->dirty = 1;
+}
+
+void runloop_quit(RunLoop *rl) {
+    rl->running = 0;
+}
+
+/* Close the stats window once it is long enough and report it */
+static void update_stats(RunLoop *rl, uint64_t now) {
+    uint64_t elapsed = now - rl->window_start_us;
+    if (elapsed < STATS_WINDOW_US) return;
+
+    rl->stats.wakeups_per_sec = (uint32_t)((uint64_t)rl->wakeups * 1000000u / elapsed);
+    rl->stats.frames_per_sec  = (uint32_t)((uint64_t)rl->frames * 1000000u / elapsed);
+    rl->stats.idle_pct        = (uint32_t)(rl->idle_us * 100 / elapsed);
+    rl->stats.frame_us_min    = rl->frame_us_min != UINT32_MAX ? rl->frame_us_min : 0;
+    rl->stats.frame_us_avg    = rl->frames ? (uint32_t)(rl->frame_us_sum / rl->frames) : 0;
+    rl->stats.frame_us_max    = rl->frame_us_max;
+    if (rl->on_stats) rl->on_stats(&rl->stats, rl->stats_user);
+
+    rl->window_start_us = now;
+    rl->idle_us = 0;
+    rl->wakeups = 0;
+    rl->frames = 0;
+    rl->frame_us_sum = 0;
+    rl->frame_us_min = UINT32_MAX;
+    rl->frame_us_max = 0;
+}
+
+void runloop_run(RunLoop *rl) {
+    rl->running = 1;
+    rl->window_start_us = monotime_us();
+    rl->frame_us_min = UINT32_MAX;
+
+    while (rl->running) {
+        if (rl->removed) compact(rl);
+        if (rl->dirty && !rl->timer_armed) set_timer(rl, 1);
+
+        uint64_t before = monotime_us();
+        int ret = poll(rl->pfds, rl->nfds, -1);
+        uint64_t after = monotime_us();
+        rl->idle_us += after - before;
+        rl->wakeups++;
+
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        // Input first, so a frame due on the same wakeup already sees it
+        for (int i = 1; i < rl->nfds && rl->running; i++) {
+            if (rl->pfds[i].fd >= 0 && (rl->pfds[i].revents & (POLLIN | POLLERR | POLLHUP))) {
+                rl->fns[i](rl->pfds[i].fd, rl->users[i]);
+            }
+        }
+
+        if (rl->pfds[0].revents & POLLIN) {
+            uint64_t expirations;
+            ssize_t n = read(rl->timer_fd, &expirations, sizeof(expirations));
+            (void)n;
+
+            if (rl->dirty) {
+                rl->dirty = 0;
+                rl->frames++;
+                if (rl->on_frame) {
+                    uint64_t t0 = monotime_us();
+                    rl->on_frame(rl->frame_user);
+                    uint32_t dt = (uint32_t)(monotime_us() - t0);
+                    rl->frame_us_sum += dt;
+                    if (dt < rl->frame_us_min) rl->frame_us_min = dt;
+                    if (dt > rl->frame_us_max) rl->frame_us_max = dt;
+                }
+            } else {
+                // Nothing changed during a whole frame: go back to sleeping
+                set_timer(rl, 0);
+            }
+        }
+
+        update_stats(rl, after);
+    }
+}
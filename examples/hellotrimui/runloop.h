@@ -0,0 +1,77 @@
+#ifndef TRIMUI_RUNLOOP_H
+#define TRIMUI_RUNLOOP_H
+
+#include <stdint.h>
+#include <poll.h>
+
+#define RUNLOOP_MAX_FDS 32
+
+typedef void (*RunLoopFdFn)(int fd, void *user);
+typedef void (*RunLoopFrameFn)(void *user);
+
+/* Activity over the last reporting window (about one second) */
+typedef struct {
+    uint32_t wakeups_per_sec;   // returns from poll()
+    uint32_t frames_per_sec;    // frame callbacks actually run
+    uint32_t idle_pct;          // share of wall time spent blocked in poll()
+    uint32_t frame_us_min;      // time spent in the frame callback, 0 without frames
+    uint32_t frame_us_avg;
+    uint32_t frame_us_max;
+} RunLoopStats;
+
+typedef void (*RunLoopStatsFn)(const RunLoopStats *stats, void *user);
+
+/* Event-driven main loop
+ *
+ * Blocks in poll() on the registered fds plus a timerfd. The timer is only
+ * armed while something is dirty: the first tick fires immediately and
+ * later ones at the frame rate, so input-to-frame latency is bounded by one
+ * frame period while an idle app sleeps in poll() with no timeout at all.
+ */
+typedef struct {
+    struct pollfd pfds[RUNLOOP_MAX_FDS + 1];   // [0] is the frame timer
+    RunLoopFdFn fns[RUNLOOP_MAX_FDS + 1];
+    void *users[RUNLOOP_MAX_FDS + 1];
+    int nfds;                   // including the timer
+    int removed;                // entries with fd == -1 waiting to be compacted
+
+    int timer_fd;
+    uint32_t frame_us;
+    int timer_armed;
+    int dirty;
+    int running;
+
+    RunLoopFrameFn on_frame;
+    void *frame_user;
+    RunLoopStatsFn on_stats;
+    void *stats_user;
+
+    // Current stats window
+    uint64_t window_start_us;
+    uint64_t idle_us;
+    uint32_t wakeups;
+    uint32_t frames;
+    uint64_t frame_us_sum;
+    uint32_t frame_us_min, frame_us_max;
+    RunLoopStats stats;         // last completed window
+} RunLoop;
+
+/* Create the loop with a frame timer at `fps`; returns 0 or -1 */
+int runloop_init(RunLoop *rl, int fps);
+void runloop_free(RunLoop *rl);
+
+/* Watch an fd for input; returns 0, or -1 if the table is full */
+int runloop_add_fd(RunLoop *rl, int fd, RunLoopFdFn fn, void *user);
+/* Stop watching an fd; safe to call from inside a callback */
+void runloop_remove_fd(RunLoop *rl, int fd);
+
+void runloop_set_frame(RunLoop *rl, RunLoopFrameFn fn, void *user);
+void runloop_set_stats(RunLoop *rl, RunLoopStatsFn fn, void *user);
+
+/* Request a frame callback on the next tick */
+void runloop_mark_dirty(RunLoop *rl);
+
+void runloop_run(RunLoop *rl);
+void runloop_quit(RunLoop *rl);
+
+#endif
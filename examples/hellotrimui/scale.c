@@ -0,0 +1,210 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "scale.h"
+
+// RGB565 spread out as 0000 0GGG GGG0 0000 RRRR R000 000B BBBB, so all three
+// channels can be weighted with a single multiply without carrying into
+// each other
+#define SPREAD_MASK 0x07E0F81Fu
+
+static inline uint32_t spread(uint16_t c) {
+    return (c | (uint32_t)c << 16) & SPREAD_MASK;
+}
+
+/* a and b spread, w = 0..32 */
+static inline uint32_t blend(uint32_t a, uint32_t b, int w) {
+    return ((a * (32 - w) + b * w) >> 5) & SPREAD_MASK;
+}
+
+/* 16.16 position of the centre of output pixel i, in source pixels */
+static int32_t centre(int i, int src, int out) {
+    return (int32_t)(((int64_t)(2 * i + 1) * src << 16) / (2 * out));
+}
+
+/* Advance a 16.16 position by one output row */
+static inline void step_row(const Scaler *s, int32_t *fy, uint32_t *err) {
+    *fy += s->y_step;
+    *err += s->y_rem;
+    if (*err >= s->y_den) {
+        *err -= s->y_den;
+        (*fy)++;
+    }
+}
+
+int scaler_init(Scaler *s, ScaleMode mode, int src_w, int src_h, int dst_w, int dst_h) {
+    memset(s, 0, sizeof(*s));
+    if (src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0 || src_w > 0xFFFF) return -1;
+
+    // Blending needs a second row and column to blend with
+    if (mode == SCALE_SMOOTH && (src_w < 2 || src_h < 2)) mode = SCALE_NEAREST;
+    s->mode = mode;
+    s->src_w = src_w;
+    s->src_h = src_h;
+    s->out = (Rect){ 0, 0, dst_w, dst_h };
+
+    if (mode == SCALE_INTEGER) {
+        // Whole factor k: output column x reads source column x / k exactly
+        int k = dst_w / src_w < dst_h / src_h ? dst_w / src_w : dst_h / src_h;
+        if (k >= 1) {
+            s->out.w = src_w * k;
+            s->out.h = src_h * k;
+            s->out.x = (dst_w - s->out.w) / 2;
+            s->out.y = (dst_h - s->out.h) / 2;
+        } else {
+            mode = s->mode = SCALE_ASPECT;
+        }
+    }
+    if (mode == SCALE_ASPECT) {
+        // Fit the longer side, then centre (cross-multiplied, no division per frame)
+        if ((int64_t)src_w * dst_h <= (int64_t)dst_w * src_h) {
+            s->out.w = (int)((int64_t)src_w * dst_h / src_h);
+        } else {
+            s->out.h = (int)((int64_t)src_h * dst_w / src_w);
+        }
+        if (s->out.w < 1) s->out.w = 1;
+        if (s->out.h < 1) s->out.h = 1;
+        s->out.x = (dst_w - s->out.w) / 2;
+        s->out.y = (dst_h - s->out.h) / 2;
+    }
+
+    int w = s->out.w, h = s->out.h;
+    s->col = malloc(w * sizeof(*s->col));
+    if (!s->col) return -1;
+    // Centre of row y = (2y + 1) * src_h / (2h): start at y = 0, step by 2 src_h / 2h
+    s->y_den = 2 * h;
+    s->y_step = (uint32_t)(((uint64_t)src_h << 17) / s->y_den);
+    s->y_rem = (uint32_t)(((uint64_t)src_h << 17) % s->y_den);
+    s->y_err0 = (uint32_t)(((uint64_t)src_h << 16) % s->y_den);
+
+    if (mode != SCALE_SMOOTH) {
+        for (int x = 0; x < w; x++) s->col[x] = (uint16_t)(centre(x, src_w, w) >> 16);
+        s->y_start = centre(0, src_h, h);
+        return 0;
+    }
+
+    // Smooth: sample between the two source pixels around each centre
+    s->col_w = malloc(w);
+    s->rows[0] = malloc(w * sizeof(uint32_t));
+    s->rows[1] = malloc(w * sizeof(uint32_t));
+    if (!s->col_w || !s->rows[0] || !s->rows[1]) {
+        scaler_free(s);
+        return -1;
+    }
+    for (int x = 0; x < w; x++) {
+        int32_t fx = centre(x, src_w, w) - 0x8000;
+        if (fx < 0) fx = 0;
+        int x0 = fx >> 16, wx = (fx >> 11) & 31;
+        if (x0 >= src_w - 1) {
+            x0 = src_w - 2;
+            wx = 32;
+        }
+        s->col[x] = (uint16_t)x0;
+        s->col_w[x] = (uint8_t)wx;
+    }
+    s->y_start = centre(0, src_h, h) - 0x8000;
+    s->row_y[0] = s->row_y[1] = -1;
+    return 0;
+}
+
+void scaler_free(Scaler *s) {
+    free(s->col);
+    free(s->col_w);
+    free(s->rows[0]);
+    free(s->rows[1]);
+    memset(s, 0, sizeof(*s));
+}
+
+static void nearest_row(uint16_t *d, const uint16_t *src, const uint16_t *col, int n) {
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        d[x] = src[col[x]];
+        d[x + 1] = src[col[x + 1]];
+        d[x + 2] = src[col[x + 2]];
+        d[x + 3] = src[col[x + 3]];
+    }
+    for (; x < n; x++) d[x] = src[col[x]];
+}
+
+static void run_nearest(Scaler *s, Canvas *dst, const Canvas *src) {
+    uint8_t *line = dst->pixels + s->out.y * dst->stride + s->out.x * 2;
+    uint8_t *prev = NULL;
+    int prev_y = -1;
+    int32_t fy = s->y_start;
+    uint32_t err = s->y_err0;
+
+    for (int y = 0; y < s->out.h; y++, line += dst->stride, step_row(s, &fy, &err)) {
+        int sy = fy >> 16;
+        if (sy >= s->src_h) sy = s->src_h - 1;
+        if (sy == prev_y) {
+            // Upscaling repeats source rows: copy the row just built
+            memcpy(line, prev, s->out.w * 2);
+        } else {
+            nearest_row((uint16_t *)line, (const uint16_t *)(src->pixels + sy * src->stride),
+                        s->col, s->out.w);
+            prev = line;
+            prev_y = sy;
+        }
+    }
+}
+
+/* Make rows[0] and rows[1] hold source rows y0 and y0 + 1, scaled horizontally */
+static void load_rows(Scaler *s, const Canvas *src, int y0) {
+    if (s->row_y[0] == y0 && s->row_y[1] == y0 + 1) return;
+    if (s->row_y[1] == y0) {
+        uint32_t *t = s->rows[0];
+        s->rows[0] = s->rows[1];
+        s->rows[1] = t;
+        s->row_y[0] = y0;
+        s->row_y[1] = -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (s->row_y[i] == y0 + i) continue;
+        // Locals: stores through out could otherwise alias the Scaler fields
+        const uint16_t *in = (const uint16_t *)(src->pixels + (y0 + i) * src->stride);
+        const uint16_t *col = s->col;
+        const uint8_t *col_w = s->col_w;
+        uint32_t *out = s->rows[i];
+        int n = s->out.w;
+        for (int x = 0; x < n; x++) {
+            const uint16_t *p = in + col[x];
+            out[x] = blend(spread(p[0]), spread(p[1]), col_w[x]);
+        }
+        s->row_y[i] = y0 + i;
+    }
+}
+
+static void run_smooth(Scaler *s, Canvas *dst, const Canvas *src) {
+    uint8_t *line = dst->pixels + s->out.y * dst->stride + s->out.x * 2;
+    int32_t fy = s->y_start;
+    uint32_t err = s->y_err0;
+    s->row_y[0] = s->row_y[1] = -1;     // a new frame
+
+    for (int y = 0; y < s->out.h; y++, line += dst->stride, step_row(s, &fy, &err)) {
+        int32_t f = fy < 0 ? 0 : fy;
+        int y0 = f >> 16, wy = (f >> 11) & 31;
+        if (y0 >= s->src_h - 1) {
+            y0 = s->src_h - 2;
+            wy = 32;
+        }
+        load_rows(s, src, y0);
+
+        uint16_t *d = (uint16_t *)line;
+        const uint32_t *r0 = s->rows[0], *r1 = s->rows[1];
+        int n = s->out.w;
+        if (wy == 0) {
+            // On a source row: nothing to blend vertically
+            for (int x = 0; x < n; x++) d[x] = (uint16_t)(r0[x] | r0[x] >> 16);
+            continue;
+        }
+        for (int x = 0; x < n; x++) {
+            uint32_t v = blend(r0[x], r1[x], wy);
+            d[x] = (uint16_t)(v | v >> 16);
+        }
+    }
+}
+
+void scaler_run(Scaler *s, Canvas *dst, const Canvas *src) {
+    if (s->mode == SCALE_SMOOTH) run_smooth(s, dst, src);
+    else run_nearest(s, dst, src);
+}
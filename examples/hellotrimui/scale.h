@@ -0,0 +1,57 @@
+#ifndef TRIMUI_SCALE_H
+#define TRIMUI_SCALE_H
+
+#include <stdint.h>
+
+#include "surface.h"
+
+typedef enum {
+    SCALE_NEAREST = 0,  // stretch to fill the whole output, nearest pixel
+    SCALE_ASPECT,       // largest size with the source aspect ratio, centred;
+                        // a fractional factor (256x224 -> 274x240 on 320x240)
+    SCALE_SMOOTH,       // stretch to fill, blending the 2x2 nearest pixels
+    SCALE_INTEGER,      // largest whole factor that fits, centred, nearest
+                        // pixel: every source pixel becomes k x k (256x224 ->
+                        // 256x224 on 320x240); sources bigger than the output
+                        // fall back to SCALE_ASPECT
+} ScaleMode;
+
+/* Scaler for one source size, output size and mode
+ *
+ * Everything that depends on the column is worked out once by scaler_init():
+ * the source column of every output column (plus its blend weight in smooth
+ * mode). Rows are stepped in 16.16 fixed point with the remainder carried
+ * Bresenham style, so the row picked is exact without any division or
+ * floating point per frame (-msoft-float emulates floats in software).
+ */
+typedef struct {
+    ScaleMode mode;
+    int src_w, src_h;
+    Rect out;               // output rectangle within the destination canvas
+
+    uint16_t *col;          // source x for each output column
+    uint8_t *col_w;         // smooth: weight of source x + 1, 0..32
+    int32_t y_start;        // source y of output row 0, 16.16
+    uint32_t y_step;        // source rows per output row, 16.16
+    uint32_t y_rem, y_den;  // step remainder: y_rem / y_den of a 16.16 unit
+    uint32_t y_err0;        // remainder of y_start
+
+    uint32_t *rows[2];      // smooth: horizontally scaled source rows, unpacked
+    int row_y[2];           // source row held in rows[i], -1 = none
+} Scaler;
+
+/* Set up scaling of src_w x src_h frames into a dst_w x dst_h area
+ * Returns 0, or -1 for an empty size or out of memory.
+ */
+int scaler_init(Scaler *s, ScaleMode mode, int src_w, int src_h, int dst_w, int dst_h);
+void scaler_free(Scaler *s);
+
+/* Scale one frame into dst at s->out, e.g. the back buffer or a canvas over
+ * the visible framebuffer page. dst must be at least dst_w x dst_h and src
+ * exactly src_w x src_h. In SCALE_ASPECT and SCALE_INTEGER modes the
+ * borders are not touched.
+ * Nothing is marked as damaged: call surface_damage() for s->out yourself.
+ */
+void scaler_run(Scaler *s, Canvas *dst, const Canvas *src);
+
+#endif
@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+
+#include "surface.h"
+
+static int rect_area(Rect r) {
+    return r.w * r.h;
+}
+
+static Rect rect_union(Rect a, Rect b) {
+    int x0 = a.x < b.x ? a.x : b.x;
+    int y0 = a.y < b.y ? a.y : b.y;
+    int x1 = (a.x + a.w) > (b.x + b.w) ? (a.x + a.w) : (b.x + b.w);
+    int y1 = (a.y + a.h) > (b.y + b.h) ? (a.y + a.h) : (b.y + b.h);
+    Rect u = { x0, y0, x1 - x0, y1 - y0 };
+    return u;
+}
+
+/* True when the rectangles overlap or share an edge */
+static int rect_touches(Rect a, Rect b) {
+    return a.x <= b.x + b.w && b.x <= a.x + a.w &&
+           a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+/* Add a rectangle to a damage list, merging it with anything it touches
+ * If the list is full, the rectangle is folded into whichever entry grows
+ * the least, so the list never loses damage, it only over-approximates it.
+ */
+static void rect_list_add(Rect *list, int *n, Rect r) {
+    int merged = 1;
+    while (merged) {
+        merged = 0;
+        for (int i = 0; i < *n; i++) {
+            if (rect_touches(list[i], r)) {
+                r = rect_union(list[i], r);
+                list[i] = list[--(*n)];
+                merged = 1;
+                break;
+            }
+        }
+    }
+
+    if (*n < SURFACE_MAX_DIRTY) {
+        list[(*n)++] = r;
+        return;
+    }
+
+    int best = 0;
+    int best_growth = 0x7fffffff;
+    for (int i = 0; i < *n; i++) {
+        int growth = rect_area(rect_union(list[i], r)) - rect_area(list[i]);
+        if (growth < best_growth) {
+            best_growth = growth;
+            best = i;
+        }
+    }
+    Rect u = rect_union(list[best], r);
+    list[best] = list[--(*n)];
+    rect_list_add(list, n, u);
+}
+
+/* Start of a page in scanout memory */
+static uint8_t *page_base(Surface *s, int page) {
+    return s->fbp + (size_t)page * s->vinfo.yres * s->finfo.line_length;
+}
+
+/* Copy one rectangle of the back buffer into scanout memory, row by row */
+static uint32_t push_rect(Surface *s, uint8_t *dst, Rect r) {
+    int stride = s->finfo.line_length;
+    size_t len = (size_t)r.w * 2;
+    const uint8_t *src = s->back.pixels + r.y * s->back.stride + r.x * 2;
+    dst += r.y * stride + r.x * 2;
+    for (int y = 0; y < r.h; y++) {
+        memcpy(dst, src, len);
+        src += s->back.stride;
+        dst += stride;
+    }
+    return (uint32_t)(len * r.h);
+}
+
+/* FBIOPAN_DISPLAY, or just accept the offset for a memory framebuffer */
+static int pan_display(Surface *s, struct fb_var_screeninfo *v) {
+    return s->fd < 0 ? 0 : ioctl(s->fd, FBIOPAN_DISPLAY, v);
+}
+
+/* Shared tail of surface_open() and surface_open_memory(): allocate the back
+ * buffer, choose between page flipping and single-page copies
+ */
+static int surface_setup(Surface *s) {
+    // The back buffer is tightly packed, cached RAM
+    s->back.width  = s->vinfo.xres;
+    s->back.height = s->vinfo.yres;
+    s->back.stride = s->back.width * 2;
+    s->back.pixels = calloc(s->back.height, s->back.stride);
+    if (!s->back.pixels) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // Use two pages when the virtual framebuffer has room for them
+    s->pages = 1;
+    s->page = 0;
+    size_t page_len = (size_t)s->vinfo.yres * s->finfo.line_length;
+    if (s->vinfo.yres_virtual >= 2 * s->vinfo.yres && 2 * page_len <= s->fb_len) {
+        struct fb_var_screeninfo pan = s->vinfo;
+        pan.xoffset = 0;
+        pan.yoffset = 0;
+        if (pan_display(s, &pan) == 0) {
+            s->vinfo = pan;
+            s->pages = 2;
+        }
+    }
+
+    // Single page: keep writing wherever the driver is currently scanning out
+    s->visible = s->fbp + (size_t)s->vinfo.yoffset * s->finfo.line_length
+               + (size_t)s->vinfo.xoffset * 2;
+
+    surface_damage_all(s);
+    for (int i = 0; i < s->num_dirty; i++) s->stale[i] = s->dirty[i];
+    s->num_stale = s->num_dirty;
+    return 0;
+}
+
+int surface_open(Surface *s, const char *dev) {
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+
+    // Try with O_EXCL first to get exclusive access, fall back to shared mode
+    s->fd = open(dev, O_RDWR | O_EXCL);
+    if (s->fd < 0) {
+        s->fd = open(dev, O_RDWR);
+        if (s->fd < 0) return -1;
+    }
+
+    if (ioctl(s->fd, FBIOGET_VSCREENINFO, &s->vinfo) < 0 ||
+        ioctl(s->fd, FBIOGET_FSCREENINFO, &s->finfo) < 0) {
+        goto fail;
+    }
+
+    // Map framebuffer into memory
+    // RGB565 format: 2 bytes per pixel (RRRRRGGGGGGBBBBB)
+    s->fb_len = s->finfo.smem_len;
+    s->fbp = mmap(NULL, s->fb_len, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (s->fbp == MAP_FAILED) {
+        s->fbp = NULL;
+        goto fail;
+    }
+
+    if (surface_setup(s) < 0) goto fail;
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        surface_close(s);
+        errno = saved;
+    }
+    return -1;
+}
+
+int surface_open_memory(Surface *s, int width, int height, int pages) {
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+
+    // Describe the buffer the way fbdev would: RGB565, `pages` screens stacked
+    s->vinfo.xres = s->vinfo.xres_virtual = width;
+    s->vinfo.yres = height;
+    s->vinfo.yres_virtual = height * (pages > 1 ? pages : 1);
+    s->vinfo.bits_per_pixel = 16;
+    s->finfo.line_length = width * 2;
+    s->finfo.xpanstep = s->finfo.ypanstep = 1;     // any window can be shown
+    s->fb_len = (size_t)s->finfo.line_length * s->vinfo.yres_virtual;
+    s->finfo.smem_len = s->fb_len;
+
+    s->fbp = calloc(1, s->fb_len);
+    if (!s->fbp || surface_setup(s) < 0) {
+        surface_close(s);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+int surface_write_ppm(const Surface *s, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+
+    int w = s->vinfo.xres, h = s->vinfo.yres;
+    uint8_t *rgb = malloc((size_t)w * 3);
+    if (!rgb) {
+        fclose(f);
+        return -1;
+    }
+
+    fprintf(f, "P6\n%d %d\n255\n", w, h);
+    for (int y = 0; y < h; y++) {
+        const uint16_t *row = (const uint16_t *)(s->visible + (size_t)y * s->finfo.line_length);
+        for (int x = 0; x < w; x++) {
+            // Expand 5/6/5 bits to 8, replicating the top bits into the bottom
+            uint16_t p = row[x];
+            uint8_t r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+            rgb[3 * x + 0] = (uint8_t)((r << 3) | (r >> 2));
+            rgb[3 * x + 1] = (uint8_t)((g << 2) | (g >> 4));
+            rgb[3 * x + 2] = (uint8_t)((b << 3) | (b >> 2));
+        }
+        fwrite(rgb, 3, w, f);
+    }
+    free(rgb);
+    return fclose(f);
+}
+
+void surface_close(Surface *s) {
+    if (s->fbp) {
+        if (s->fd >= 0) munmap(s->fbp, s->fb_len);
+        else            free(s->fbp);
+        s->fbp = NULL;
+        s->visible = NULL;
+    }
+    free(s->back.pixels);
+    s->back.pixels = NULL;
+    if (s->fd >= 0) close(s->fd);
+    s->fd = -1;
+}
+
+void surface_damage(Surface *s, int x, int y, int w, int h) {
+    // Clip against the screen
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > s->back.width)  w = s->back.width - x;
+    if (y + h > s->back.height) h = s->back.height - y;
+    if (w <= 0 || h <= 0) return;
+
+    Rect r = { x, y, w, h };
+    rect_list_add(s->dirty, &s->num_dirty, r);
+}
+
+void surface_damage_all(Surface *s) {
+    surface_damage(s, 0, 0, s->back.width, s->back.height);
+}
+
+uint32_t surface_flush(Surface *s) {
+    uint32_t bytes = 0;
+
+    if (s->pages == 2) {
+        // The hidden page is two frames old: it needs this frame's damage
+        // plus whatever was drawn into the other page last time
+        Rect todo[SURFACE_MAX_DIRTY];
+        int n = 0;
+        for (int i = 0; i < s->num_stale; i++) rect_list_add(todo, &n, s->stale[i]);
+        for (int i = 0; i < s->num_dirty; i++) rect_list_add(todo, &n, s->dirty[i]);
+
+        if (n > 0) {
+            int next = s->page ^ 1;
+            uint8_t *dst = page_base(s, next);
+            for (int i = 0; i < n; i++) bytes += push_rect(s, dst, todo[i]);
+
+            s->vinfo.yoffset = next * s->vinfo.yres;
+            if (pan_display(s, &s->vinfo) == 0) {
+                s->page = next;
+                s->visible = dst;
+            } else {
+                // Driver refused to pan: stay on the visible page from now on
+                s->vinfo.yoffset = s->page * s->vinfo.yres;
+                s->pages = 1;
+                surface_damage_all(s);
+                return surface_flush(s);
+            }
+        }
+
+        for (int i = 0; i < s->num_dirty; i++) s->stale[i] = s->dirty[i];
+        s->num_stale = s->num_dirty;
+    } else {
+        for (int i = 0; i < s->num_dirty; i++) bytes += push_rect(s, s->visible, s->dirty[i]);
+    }
+
+    s->num_dirty = 0;
+    s->bytes_last_frame = bytes;
+    s->bytes_total += bytes;
+    if (bytes) s->frames++;
+    return bytes;
+}
+
+int surface_set_virtual(Surface *s, int xres_virtual, int yres_virtual) {
+    struct fb_var_screeninfo v = s->vinfo;
+    struct fb_fix_screeninfo f = s->finfo;
+    v.xres_virtual = xres_virtual;
+    v.yres_virtual = yres_virtual;
+    v.xoffset = 0;
+    v.yoffset = 0;
+
+    if (s->fd < 0) {
+        f.line_length = xres_virtual * 2;
+        f.smem_len = f.line_length * yres_virtual;
+        uint8_t *mem = calloc(1, f.smem_len);
+        if (!mem) return -1;
+        free(s->fbp);
+        s->fbp = mem;
+        s->fb_len = f.smem_len;
+    } else {
+        // The driver may round the size up or refuse it outright
+        if (ioctl(s->fd, FBIOPUT_VSCREENINFO, &v) < 0) return -1;
+        if (ioctl(s->fd, FBIOGET_VSCREENINFO, &v) < 0 ||
+            ioctl(s->fd, FBIOGET_FSCREENINFO, &f) < 0 ||
+            (int)v.xres_virtual < xres_virtual || (int)v.yres_virtual < yres_virtual ||
+            (size_t)f.line_length * v.yres_virtual > f.smem_len) {
+            ioctl(s->fd, FBIOPUT_VSCREENINFO, &s->vinfo);
+            return -1;
+        }
+
+        // A larger mode may come with a larger buffer: map all of it
+        if (f.smem_len != s->fb_len) {
+            uint8_t *mem = mmap(NULL, f.smem_len, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+            if (mem == MAP_FAILED) {
+                ioctl(s->fd, FBIOPUT_VSCREENINFO, &s->vinfo);
+                return -1;
+            }
+            munmap(s->fbp, s->fb_len);
+            s->fbp = mem;
+            s->fb_len = f.smem_len;
+        }
+    }
+
+    s->vinfo = v;
+    s->finfo = f;
+    s->pages = 1;
+    s->page = 0;
+    s->visible = s->fbp;
+    s->num_stale = 0;
+    surface_damage_all(s);
+    return 0;
+}
+
+int surface_pan(Surface *s, int x, int y) {
+    struct fb_var_screeninfo v = s->vinfo;
+    v.xoffset = x;
+    v.yoffset = y;
+    if (pan_display(s, &v) < 0) return -1;
+    s->vinfo = v;
+    s->visible = s->fbp + (size_t)y * s->finfo.line_length + (size_t)x * 2;
+    return 0;
+}
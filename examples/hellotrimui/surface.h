@@ -0,0 +1,93 @@
+#ifndef TRIMUI_SURFACE_H
+#define TRIMUI_SURFACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/fb.h>
+
+/* A drawable RGB565 pixel buffer (2 bytes per pixel, `stride` bytes per row)
+ * Every drawing routine in the example takes one of these, so the same code
+ * can target the RAM back buffer or the mmap'd framebuffer directly.
+ */
+typedef struct {
+    uint8_t *pixels;
+    int stride;
+    int width;
+    int height;
+} Canvas;
+
+typedef struct {
+    int x, y, w, h;
+} Rect;
+
+/* Damage rectangles tracked per frame before they get merged together */
+#define SURFACE_MAX_DIRTY 16
+
+/* Off-screen rendering surface on top of /dev/fb0
+ *
+ * Drawing goes into `back`, a cached RAM copy of the screen. Callers report
+ * what they touched with surface_damage() and surface_flush() copies only the
+ * merged dirty rectangles to scanout memory, which is uncached and slow to
+ * write on the ARM926.
+ *
+ * When the driver exposes a virtual framebuffer at least twice as tall as the
+ * visible one, the surface flips between two pages with FBIOPAN_DISPLAY
+ * instead of writing into the page being scanned out, so there is no tearing.
+ */
+typedef struct {
+    int fd;                 // -1 for a memory framebuffer
+    struct fb_var_screeninfo vinfo;
+    struct fb_fix_screeninfo finfo;
+    uint8_t *fbp;           // mmap'd scanout memory
+    uint8_t *visible;       // start of the page currently on screen
+    size_t fb_len;
+
+    Canvas back;            // RAM back buffer, draw here
+
+    int pages;              // 2 = page flipping, 1 = copy into the visible page
+    int page;               // page currently on screen
+
+    Rect dirty[SURFACE_MAX_DIRTY];   // damage since the last flush
+    int num_dirty;
+    Rect stale[SURFACE_MAX_DIRTY];   // previous frame's damage, missing from the hidden page
+    int num_stale;
+
+    // Bandwidth counters: bytes copied into scanout memory
+    uint32_t bytes_last_frame;
+    uint64_t bytes_total;
+    uint32_t frames;
+} Surface;
+
+/* Open and map the framebuffer device and allocate the back buffer
+ * Returns 0 on success, -1 on failure (errno is preserved).
+ */
+int surface_open(Surface *s, const char *dev);
+void surface_close(Surface *s);
+
+/* Same surface over a plain memory framebuffer (headless runs, benchmarks)
+ * With pages = 2 the page-flipping path is exercised without any ioctl.
+ */
+int surface_open_memory(Surface *s, int width, int height, int pages);
+
+/* Write the page currently on screen as a binary PPM; returns 0 or -1 */
+int surface_write_ppm(const Surface *s, const char *path);
+
+/* Mark a region of the back buffer as changed (clipped to the screen) */
+void surface_damage(Surface *s, int x, int y, int w, int h);
+void surface_damage_all(Surface *s);
+
+/* Push damaged regions to the display; returns bytes written this frame */
+uint32_t surface_flush(Surface *s);
+
+/* Resize the virtual framebuffer for hardware scrolling
+ * Asks the driver for at least xres_virtual x yres_virtual (memory surfaces
+ * just grow). Page flipping is turned off: surface_flush() then writes into
+ * whichever window surface_pan() shows. Returns 0, or -1 if the driver or
+ * its memory cannot provide that much, in which case nothing changes.
+ */
+int surface_set_virtual(Surface *s, int xres_virtual, int yres_virtual);
+
+/* Show the screen-sized window at (x, y) of the virtual framebuffer */
+int surface_pan(Surface *s, int x, int y);
+
+#endif
@@ -0,0 +1,178 @@
+#include <string.h>
+
+#include "tilemap.h"
+#include "gfx.h"
+
+static int wrap(int v, int period) {
+    v %= period;
+    return v < 0 ? v + period : v;
+}
+
+/* Some drivers accept a larger virtual screen and still refuse to pan
+ * across it, so try a pan before relying on one
+ */
+static int pan_works(Surface *s, int x, int y) {
+    return surface_pan(s, x, y) == 0 && surface_pan(s, 0, 0) == 0;
+}
+
+/* Scroll the back buffer instead: nothing is panned from here on */
+static void use_software(TileMap *tm) {
+    tm->mode = TILEMAP_SOFTWARE;
+    tm->plane = tm->surf->back;
+    tm->period_w = tm->period_h = 0;
+}
+
+int tilemap_init(TileMap *tm, Surface *s, const Canvas *tiles, int tile_w, int tile_h,
+                 const uint16_t *map, int map_w, int map_h) {
+    memset(tm, 0, sizeof(*tm));
+    if (tile_w <= 0 || tile_h <= 0 || tiles->width < tile_w || tiles->height < tile_h) return -1;
+
+    tm->surf = s;
+    tm->tiles = tiles;
+    tm->tile_w = tile_w;
+    tm->tile_h = tile_h;
+    tm->sheet_cols = tiles->width / tile_w;
+    tm->map = map;
+    tm->map_w = map_w;
+    tm->map_h = map_h;
+    tm->screen_w = s->vinfo.xres;
+    tm->screen_h = s->vinfo.yres;
+
+    // Two screens plus a tile of margin each way, then vertical wrap only
+    // (with or without margin), then give up on panning. Scrolling moves a
+    // pixel at a time, so an axis is only panned with a pan step of 1
+    // (xpanstep 0 means the driver cannot pan across at all).
+    int w = tm->screen_w, h = tm->screen_h;
+    if (s->finfo.xpanstep == 1 && s->finfo.ypanstep == 1 &&
+        surface_set_virtual(s, 2 * w + tile_w, 2 * h + tile_h) == 0 && pan_works(s, tile_w, tile_h)) {
+        tm->mode = TILEMAP_PAN_XY;
+    } else if (s->finfo.ypanstep == 1 &&
+               (surface_set_virtual(s, w, 2 * h + tile_h) == 0 ||
+                surface_set_virtual(s, w, 2 * h) == 0) && pan_works(s, 0, tile_h)) {
+        tm->mode = TILEMAP_PAN_Y;
+    } else {
+        tm->mode = TILEMAP_SOFTWARE;
+    }
+
+    if (tm->mode == TILEMAP_SOFTWARE) {
+        use_software(tm);
+    } else {
+        tm->plane.pixels = s->fbp;
+        tm->plane.stride = s->finfo.line_length;
+        tm->plane.width = s->vinfo.xres_virtual;
+        tm->plane.height = s->vinfo.yres_virtual;
+        tm->period_w = tm->mode == TILEMAP_PAN_XY ? tm->plane.width - w : 0;
+        tm->period_h = tm->plane.height - h;
+        // The map owns scanout memory now; nothing in the back buffer is pending
+        s->num_dirty = 0;
+    }
+    return 0;
+}
+
+void tilemap_invalidate(TileMap *tm) {
+    tm->drawn = 0;
+}
+
+/* Copy the map pixels [mx, mx+w) x [my, my+h) to (px, py) on the plane */
+static void draw_piece(TileMap *tm, int mx, int my, int w, int h, int px, int py) {
+    int tw = tm->tile_w, th = tm->tile_h;
+    for (int ty = my / th; ty * th < my + h; ty++) {
+        int y0 = ty * th > my ? ty * th : my;
+        int y1 = (ty + 1) * th < my + h ? (ty + 1) * th : my + h;
+        for (int tx = mx / tw; tx * tw < mx + w; tx++) {
+            int x0 = tx * tw > mx ? tx * tw : mx;
+            int x1 = (tx + 1) * tw < mx + w ? (tx + 1) * tw : mx + w;
+            int dx = px + x0 - mx, dy = py + y0 - my;
+
+            if (tx < tm->map_w && ty < tm->map_h) {
+                int t = tm->map[ty * tm->map_w + tx];
+                int sx = (t % tm->sheet_cols) * tw + x0 - tx * tw;
+                int sy = (t / tm->sheet_cols) * th + y0 - ty * th;
+                gfx_copy(&tm->plane, dx, dy, tm->tiles, sx, sy, x1 - x0, y1 - y0);
+            } else {
+                gfx_fill(&tm->plane, dx, dy, x1 - x0, y1 - y0, tm->void_color);
+            }
+            tm->tiles_drawn++;
+        }
+    }
+}
+
+/* Split one axis of a map range at the wrap point: up to two segments of
+ * (map start, length, plane start); a non-wrapping axis is relative to the view
+ */
+static int split_axis(int m, int len, int period, int view, int seg[2][3]) {
+    if (!period) {
+        seg[0][0] = m; seg[0][1] = len; seg[0][2] = m - view;
+        return 1;
+    }
+    int p = wrap(m, period);
+    int first = len < period - p ? len : period - p;
+    seg[0][0] = m; seg[0][1] = first; seg[0][2] = p;
+    if (first == len) return 1;
+    seg[1][0] = m + first; seg[1][1] = len - first; seg[1][2] = 0;
+    return 2;
+}
+
+/* Draw a map rectangle everywhere it can appear on the plane */
+static void draw_rect(TileMap *tm, int mx, int my, int w, int h) {
+    int xs[2][3], ys[2][3];
+    int nx = split_axis(mx, w, tm->period_w, tm->view_x, xs);
+    int ny = split_axis(my, h, tm->period_h, tm->view_y, ys);
+
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            // A wrapping axis keeps a second copy one period further on,
+            // for windows that straddle the end of the first period
+            for (int cy = 0; cy < (tm->period_h ? 2 : 1); cy++) {
+                for (int cx = 0; cx < (tm->period_w ? 2 : 1); cx++) {
+                    int px = xs[i][2] + cx * tm->period_w;
+                    int py = ys[j][2] + cy * tm->period_h;
+                    if (px >= tm->plane.width || py >= tm->plane.height) continue;
+                    draw_piece(tm, xs[i][0], ys[j][0], xs[i][1], ys[j][1], px, py);
+                }
+            }
+        }
+    }
+}
+
+void tilemap_scroll_to(TileMap *tm, int x, int y) {
+    int w = tm->screen_w, h = tm->screen_h;
+    int max_x = tm->map_w * tm->tile_w - w;
+    int max_y = tm->map_h * tm->tile_h - h;
+    if (x > max_x) x = max_x;
+    if (y > max_y) y = max_y;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+
+    int dx = x - tm->view_x, dy = y - tm->view_y;
+    if (tm->drawn && !dx && !dy) return;
+
+    int full = !tm->drawn || dx >= w || -dx >= w || dy >= h || -dy >= h;
+    if (tm->mode == TILEMAP_PAN_Y && dx) full = 1;
+    if (tm->mode == TILEMAP_SOFTWARE && !full) {
+        // Move what stays on screen, then fill in the edges like the other modes
+        gfx_copy(&tm->plane, -dx, -dy, &tm->plane, 0, 0, w, h);
+    }
+
+    tm->tiles_drawn = 0;
+    tm->view_x = x;
+    tm->view_y = y;
+    if (full) {
+        draw_rect(tm, x, y, w, h);
+    } else {
+        if (dx > 0) draw_rect(tm, x + w - dx, y, dx, h);
+        if (dx < 0) draw_rect(tm, x, y, -dx, h);
+        if (dy > 0) draw_rect(tm, x, y + h - dy, w, dy);
+        if (dy < 0) draw_rect(tm, x, y, w, -dy);
+    }
+    tm->drawn = 1;
+
+    if (tm->mode != TILEMAP_SOFTWARE &&
+        surface_pan(tm->surf, tm->period_w ? wrap(x, tm->period_w) : 0, wrap(y, tm->period_h)) < 0) {
+        // The driver stopped panning: the screen still shows the last window
+        // that worked, which surface_flush() now writes to
+        use_software(tm);
+        draw_rect(tm, x, y, w, h);
+    }
+    if (tm->mode == TILEMAP_SOFTWARE) surface_damage_all(tm->surf);
+}
@@ -0,0 +1,67 @@
+#ifndef TRIMUI_TILEMAP_H
+#define TRIMUI_TILEMAP_H
+
+#include <stdint.h>
+
+#include "surface.h"
+
+/* How the tile map reaches the screen, best first */
+typedef enum {
+    TILEMAP_PAN_XY = 0,     // virtual framebuffer wraps both ways, FBIOPAN_DISPLAY only
+    TILEMAP_PAN_Y,          // wraps vertically; horizontal moves redraw the view
+    TILEMAP_SOFTWARE,       // no room to pan: scroll the back buffer and flush it
+} TileMapMode;
+
+/* Scrolling tile map on a hardware-panned framebuffer
+ *
+ * The virtual framebuffer is set up as a "plane" that wraps: map pixel x is
+ * drawn at x mod period_w, and again one period further right, so every
+ * screen-sized window starting inside the first period is complete. The
+ * period is the screen size plus whatever margin the driver's memory allows;
+ * with a margin of at least the per-frame scroll distance, newly exposed
+ * tiles land outside the window being scanned out.
+ *
+ * Scrolling draws only the tile rows and columns that come into view and
+ * then pans the display, so the cost does not depend on the screen size.
+ * Tiles are copied straight into scanout memory; the back buffer is not
+ * used except in TILEMAP_SOFTWARE mode.
+ */
+typedef struct {
+    Surface *surf;
+    TileMapMode mode;
+
+    // Tile sheet: tiles left to right, then top to bottom
+    const Canvas *tiles;
+    int tile_w, tile_h;
+    int sheet_cols;
+
+    const uint16_t *map;    // map_w * map_h tile indices, row-major
+    int map_w, map_h;       // in tiles
+    uint16_t void_color;    // outside the map
+
+    Canvas plane;           // the virtual framebuffer (or the back buffer)
+    int screen_w, screen_h;
+    int period_w, period_h; // wrap periods on the plane, 0 = axis does not wrap
+
+    int view_x, view_y;     // map pixel shown at the top-left corner
+    int drawn;              // the plane holds the current view
+    uint32_t tiles_drawn;   // tile pieces copied by the last scroll
+} TileMap;
+
+/* Attach a map to the surface and size its virtual framebuffer
+ * Falls back through the modes above if the driver refuses the larger
+ * framebuffers, cannot pan an axis a pixel at a time (finfo.xpanstep,
+ * ypanstep) or fails a test pan. Returns 0, or -1 for an invalid tile sheet.
+ */
+int tilemap_init(TileMap *tm, Surface *s, const Canvas *tiles, int tile_w, int tile_h,
+                 const uint16_t *map, int map_w, int map_h);
+
+/* Show the map with (x, y) at the top-left corner of the screen
+ * If the pan fails, the map drops to TILEMAP_SOFTWARE and redraws the view.
+ */
+void tilemap_scroll_to(TileMap *tm, int x, int y);
+
+/* Redraw the whole view on the next scroll (after the map changed) */
+void tilemap_invalidate(TileMap *tm);
+
+#endif
@@ -0,0 +1,159 @@
+/* capdump: decode a capture stream (see capture.h) on the host
+ *
+ *   capdump IN.tcap                    list the frames
+ *   capdump IN.tcap OUT.ppm            the last frame, as a screenshot
+ *   capdump IN.tcap OUT.ppm --frame N  the first frame with seq >= N
+ *   capdump IN.tcap OUT%d.ppm          every frame, numbered by seq
+ *
+ * OUT is numbered only when it holds exactly one "%d" and no other '%';
+ * anything else is a plain file name.
+ *
+ * Gaps in seq are frames the device dropped because the writer could not
+ * keep up. Frames before the first key frame cannot be decoded and are
+ * skipped, so a cut-off stream still yields everything from a key frame on.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../capture.h"
+
+static int write_ppm(const char *path, const uint16_t *px, int w, int h) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", w, h);
+    for (int i = 0; i < w * h; i++) {
+        // Expand 5/6/5 bits to 8 the same way surface_write_ppm() does
+        uint16_t p = px[i];
+        uint8_t r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+        uint8_t rgb[3] = { (uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)),
+                           (uint8_t)((b << 3) | (b >> 2)) };
+        fwrite(rgb, 1, 3, f);
+    }
+    return fclose(f);
+}
+
+/* Apply one frame's tokens to `px`; returns 0, or -1 if they are malformed */
+static int decode(uint16_t *px, int n, const uint8_t *tokens, uint32_t size, int key) {
+    if (key) memset(px, 0, (size_t)n * 2);
+    const uint8_t *p = tokens, *end = tokens + size;
+    int i = 0;
+    while (p + 2 <= end) {
+        uint16_t t = p[0] | p[1] << 8;
+        int k = t & 0x8000 ? t & 0x3FFF : t;
+        p += 2;
+        if (k > n - i) return -1;
+        if (!(t & 0x8000)) {
+            i += k;     // unchanged
+        } else if (t & 0x4000) {
+            if (end - p < 2) return -1;
+            uint16_t v = (uint16_t)(p[0] | p[1] << 8);
+            p += 2;
+            for (; k > 0; k--) px[i++] ^= v;
+        } else {
+            if ((size_t)(end - p) < (size_t)k * 2) return -1;
+            for (; k > 0; k--, p += 2) px[i++] ^= (uint16_t)(p[0] | p[1] << 8);
+        }
+    }
+    return p == end ? 0 : -1;
+}
+
+/* Offset of the only "%d" in `path`, or -1 if there is none or any other '%' */
+static int frame_number_at(const char *path) {
+    const char *d = strstr(path, "%d");
+    if (!d) return -1;
+    for (const char *c = path; *c; c++) {
+        if (*c == '%' && c != d) return -1;
+    }
+    return (int)(d - path);
+}
+
+int main(int argc, char **argv) {
+    const char *in = NULL, *out = NULL;
+    long want = -1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frame") && i + 1 < argc) want = atol(argv[++i]);
+        else if (!in) in = argv[i];
+        else if (!out) out = argv[i];
+        else in = NULL, i = argc;
+    }
+    if (!in) {
+        fprintf(stderr, "usage: capdump IN.tcap [OUT.ppm | OUT%%d.ppm] [--frame N]\n");
+        return 2;
+    }
+    int at = out ? frame_number_at(out) : -1;
+    int numbered = at >= 0;
+
+    FILE *f = fopen(in, "rb");
+    if (!f) {
+        perror(in);
+        return 1;
+    }
+    CaptureHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != CAPTURE_MAGIC || h.version != CAPTURE_VERSION) {
+        fprintf(stderr, "capdump: %s is not a capture stream\n", in);
+        return 1;
+    }
+    int n = h.width * h.height;
+    uint16_t *px = malloc((size_t)n * 2);
+    uint8_t *tokens = malloc(capture_max_size(n));
+
+    CaptureFrame fr;
+    uint32_t frames = 0, decoded = 0, gaps = 0, next_seq = 0, first_t = 0, last_t = 0;
+    uint64_t bytes = 0;
+    int have_key = 0, have_frame = 0;
+    while (fread(&fr, sizeof(fr), 1, f) == 1) {
+        if (fr.size > capture_max_size(n) || fread(tokens, 1, fr.size, f) != fr.size) {
+            fprintf(stderr, "capdump: stream cut off in frame %u\n", fr.seq);
+            break;
+        }
+        if (frames == 0) first_t = fr.t_us;
+        last_t = fr.t_us;
+        gaps += fr.seq - next_seq;
+        next_seq = fr.seq + 1;
+        frames++;
+        bytes += sizeof(fr) + fr.size;
+
+        int key = fr.flags & CAPTURE_KEY_FRAME;
+        if (!out) {
+            printf("%6u %10.3f ms %8u bytes%s\n", fr.seq, fr.t_us / 1000.0, fr.size, key ? " key" : "");
+        }
+        if (!key && !have_key) continue;
+        if (decode(px, n, tokens, fr.size, key) < 0) {
+            fprintf(stderr, "capdump: bad tokens in frame %u, waiting for a key frame\n", fr.seq);
+            have_key = 0;
+            continue;
+        }
+        have_key = 1;
+        decoded++;
+
+        if (numbered) {
+            char name[1024];
+            snprintf(name, sizeof(name), "%.*s%u%s", at, out, fr.seq, out + at + 2);
+            if (write_ppm(name, px, h.width, h.height) < 0) return 1;
+        } else if (out && want >= 0 && fr.seq >= want) {
+            have_frame = 1;
+            break;
+        }
+        have_frame = 1;
+    }
+    fclose(f);
+
+    if (out && !numbered) {
+        if (!have_frame) {
+            fprintf(stderr, "capdump: no frame to write\n");
+            return 1;
+        }
+        if (write_ppm(out, px, h.width, h.height) < 0) return 1;
+    }
+    fprintf(stderr, "capdump: %dx%d, %u frames (%u decoded, %u dropped on device) over %.1f s, "
+            "%llu bytes, %.1f%% of raw\n",
+            h.width, h.height, frames, decoded, gaps, (last_t - first_t) / 1e6,
+            (unsigned long long)bytes, frames ? 100.0 * bytes / ((double)frames * n * 2) : 0.0);
+    free(px);
+    free(tokens);
+    return 0;
+}
@@ -0,0 +1,155 @@
+/* mkadpcm: encode music for music.c (see music.h) on the host
+ *
+ *   mkadpcm IN.wav OUT.wav [BLOCK_ALIGN]
+ *
+ * IN is 16-bit mono PCM at the rate the program plays (22050 Hz for
+ * hellotrimui); OUT is the same audio as mono IMA-ADPCM, a quarter of the
+ * size. BLOCK_ALIGN is the block size in bytes (default 512, 1017 samples,
+ * what sox picks at 22050 Hz); the encoder uses the decoder's own nibble
+ * step, so both sides track the same predictor.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../music.h"
+
+static void die(const char *msg, const char *arg) {
+    fprintf(stderr, "mkadpcm: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+static uint8_t *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) die("cannot open", path);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(size > 0 ? size : 1);
+    if (!buf || fread(buf, 1, size, f) != (size_t)size) die("cannot read", path);
+    fclose(f);
+    *len = size;
+    return buf;
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put16(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+/* Pick the code that lands closest to `sample`, then step the state with it */
+static int encode_nibble(ImaState *s, int sample) {
+    int step = ima_step_table[s->index];
+    int diff = sample - s->predictor;
+    int code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) { code |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) code |= 1;
+
+    ima_decode_nibble(s, code);
+    return code;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "usage: mkadpcm IN.wav OUT.wav [BLOCK_ALIGN]\n");
+        return 2;
+    }
+    int align = argc == 4 ? atoi(argv[3]) : 512;
+    if (align < 5 || (align - 4) * 2 + 1 > MUSIC_BUFFER_SAMPLES) die("bad block size", argc == 4 ? argv[3] : NULL);
+
+    size_t len;
+    uint8_t *buf = read_file(argv[1], &len);
+    const uint8_t *pcm = NULL;
+    uint32_t pcm_len = 0, rate = 0;
+    if (len < 12 || memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4)) die("not a WAV file", argv[1]);
+    for (size_t off = 12; off + 8 <= len;) {
+        uint32_t size = le32(buf + off + 4);
+        const uint8_t *body = buf + off + 8;
+        if (size > len - off - 8) size = len - off - 8;
+        if (!memcmp(buf + off, "fmt ", 4) && size >= 16) {
+            int format = body[0] | body[1] << 8, channels = body[2] | body[3] << 8;
+            int bits = body[14] | body[15] << 8;
+            if (format != 1 || channels != 1 || bits != 16) die("need 16-bit mono PCM WAV", argv[1]);
+            rate = le32(body + 4);
+        } else if (!memcmp(buf + off, "data", 4)) {
+            pcm = body;
+            pcm_len = size;
+        }
+        off += 8 + size + (size & 1);
+    }
+    if (!rate || !pcm) die("incomplete WAV", argv[1]);
+
+    uint32_t total = pcm_len / 2;
+    int block_samples = (align - 4) * 2 + 1;
+    uint32_t blocks = (total + block_samples - 1) / block_samples;
+    uint32_t data_bytes = blocks * align;
+
+    // RIFF, fmt with the samples-per-block extension, fact, data
+    uint8_t h[60];
+    memset(h, 0, sizeof(h));
+    memcpy(h, "RIFF", 4);
+    put32(h + 4, 52 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 20);
+    put16(h + 20, 0x0011);
+    put16(h + 22, 1);
+    put32(h + 24, rate);
+    put32(h + 28, (uint32_t)((uint64_t)rate * align / block_samples));
+    put16(h + 32, align);
+    put16(h + 34, 4);
+    put16(h + 36, 2);
+    put16(h + 38, block_samples);
+    memcpy(h + 40, "fact", 4);
+    put32(h + 44, 4);
+    put32(h + 48, total);
+    memcpy(h + 52, "data", 4);
+    put32(h + 56, data_bytes);
+
+    FILE *f = fopen(argv[2], "wb");
+    if (!f || fwrite(h, 1, sizeof(h), f) != sizeof(h)) die("cannot write", argv[2]);
+
+    // The last block is padded with its final sample; the fact chunk trims it
+    uint8_t *block = malloc(align);
+    ImaState s = { 0, 0 };
+    for (uint32_t b = 0; b < blocks; b++) {
+        uint32_t first = b * block_samples;
+        int16_t x[MUSIC_BUFFER_SAMPLES];
+        for (int i = 0; i < block_samples; i++) {
+            uint32_t k = first + i < total ? first + i : total - 1;
+            x[i] = (int16_t)(pcm[k * 2] | pcm[k * 2 + 1] << 8);
+        }
+        s.predictor = x[0];
+        put16(block, (uint16_t)x[0]);
+        block[2] = (uint8_t)s.index;
+        block[3] = 0;
+        for (int i = 0; i < align - 4; i++) {
+            int lo = encode_nibble(&s, x[1 + 2 * i]);
+            int hi = encode_nibble(&s, x[2 + 2 * i]);
+            block[4 + i] = (uint8_t)(lo | hi << 4);
+        }
+        if (fwrite(block, 1, align, f) != (size_t)align) die("cannot write", argv[2]);
+    }
+    if (fclose(f) != 0) die("cannot write", argv[2]);
+
+    fprintf(stderr, "mkadpcm: %u samples at %u Hz, %u blocks, %u -> %u bytes\n",
+            total, rate, blocks, pcm_len, data_bytes + (uint32_t)sizeof(h));
+    free(block);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,267 @@
+/* mkpack: build an asset pack (see asset.h) on the host
+ *
+ *   mkpack MANIFEST OUT.pak
+ *
+ * The manifest lists one asset per line; paths are relative to the manifest:
+ *
+ *   align  BYTES                      row alignment for the images below (default 4)
+ *   image  NAME  FILE.ppm  [STRIDE]   binary PPM (P6), converted to RGB565
+ *   font   NAME  SCALE FG BG [opaque] built-in 8x8 font, colours as RGB565 hex
+ *   sound  NAME  FILE [RATE]          .wav (16-bit mono PCM) or raw s16le
+ *   raw    NAME  FILE                 copied as is
+ *
+ * '#' starts a comment. Give full-screen images STRIDE = finfo.line_length
+ * (640 on the Model S) so they can be copied to the framebuffer in one go.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../asset.h"
+#include "../gfx.h"
+#include "../glyph.h"
+
+#define MAX_ASSETS 1024
+
+typedef struct {
+    char name[64];
+    AssetEntry e;
+    uint8_t *data;
+} Item;
+
+static Item items[MAX_ASSETS];
+static int num_items;
+static char base_dir[512];
+static int line_no;
+
+static void die(const char *msg, const char *arg) {
+    fprintf(stderr, "mkpack: line %d: %s%s%s\n", line_no, msg, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+static uint8_t *read_file(const char *name, size_t *len) {
+    char path[1024];
+    if (name[0] == '/') snprintf(path, sizeof(path), "%s", name);
+    else snprintf(path, sizeof(path), "%s%s", base_dir, name);
+
+    FILE *f = fopen(path, "rb");
+    if (!f) die("cannot open", path);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(size > 0 ? size : 1);
+    if (!buf || fread(buf, 1, size, f) != (size_t)size) die("cannot read", path);
+    fclose(f);
+    *len = size;
+    return buf;
+}
+
+/* Next whitespace-separated number in a PPM header, skipping comments */
+static int ppm_number(const uint8_t **p, const uint8_t *end) {
+    for (;;) {
+        while (*p < end && (**p == ' ' || **p == '\t' || **p == '\n' || **p == '\r')) (*p)++;
+        if (*p < end && **p == '#') {
+            while (*p < end && **p != '\n') (*p)++;
+            continue;
+        }
+        break;
+    }
+    int v = -1;
+    while (*p < end && **p >= '0' && **p <= '9') {
+        v = (v < 0 ? 0 : v * 10) + (**p - '0');
+        (*p)++;
+    }
+    return v;
+}
+
+static void add_image(Item *it, const char *file, int stride, int align) {
+    size_t len;
+    uint8_t *ppm = read_file(file, &len);
+    const uint8_t *p = ppm + 2, *end = ppm + len;
+    if (len < 2 || ppm[0] != 'P' || ppm[1] != '6') die("not a binary PPM (P6)", file);
+    int w = ppm_number(&p, end), h = ppm_number(&p, end), maxval = ppm_number(&p, end);
+    p++;    // single whitespace before the pixels
+    if (w <= 0 || h <= 0 || maxval != 255 || (size_t)(end - p) < (size_t)w * h * 3) {
+        die("unsupported PPM (need 8-bit RGB)", file);
+    }
+
+    if (stride <= 0) stride = (w * 2 + align - 1) / align * align;
+    if (stride < w * 2 || stride % 2 || stride > 0xFFFF) die("bad stride for", file);
+
+    it->e.type = ASSET_IMAGE;
+    it->e.width = w;
+    it->e.height = h;
+    it->e.stride = stride;
+    it->e.size = stride * h;
+    it->data = calloc(1, it->e.size);
+    for (int y = 0; y < h; y++) {
+        uint16_t *row = (uint16_t *)(it->data + y * stride);
+        for (int x = 0; x < w; x++, p += 3) row[x] = rgb565(p[0], p[1], p[2]);
+    }
+    free(ppm);
+}
+
+static void add_font(Item *it, int scale, unsigned fg, unsigned bg, int opaque) {
+    GlyphAtlas a;
+    if (glyph_atlas_init(&a, scale, fg, bg, opaque) < 0) die("bad font scale", NULL);
+
+    it->e.type = ASSET_FONT;
+    it->e.width = a.cell_w;
+    it->e.height = a.cell_h;
+    it->e.stride = scale;
+    it->e.param = a.fg | (uint32_t)a.bg << 16;
+    it->e.flags = opaque ? 1 : 0;
+
+    size_t pixels = opaque ? (size_t)GLYPH_COUNT * GLYPH_H * a.cell_w * sizeof(uint16_t) : 0;
+    it->e.size = sizeof(a.masks) + pixels;
+    it->data = malloc(it->e.size);
+    memcpy(it->data, a.masks, sizeof(a.masks));
+    if (pixels) memcpy(it->data + sizeof(a.masks), a.pixels, pixels);
+    glyph_atlas_free(&a);
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void add_sound(Item *it, const char *file, int rate) {
+    size_t len;
+    uint8_t *buf = read_file(file, &len);
+    const uint8_t *pcm = buf;
+    size_t pcm_len = len;
+
+    if (len >= 12 && !memcmp(buf, "RIFF", 4) && !memcmp(buf + 8, "WAVE", 4)) {
+        // Walk the chunks for fmt and data
+        pcm = NULL;
+        int ok_fmt = 0;
+        for (size_t off = 12; off + 8 <= len;) {
+            uint32_t size = le32(buf + off + 4);
+            const uint8_t *body = buf + off + 8;
+            if (size > len - off - 8) size = len - off - 8;
+            if (!memcmp(buf + off, "fmt ", 4) && size >= 16) {
+                int format = body[0] | body[1] << 8, channels = body[2] | body[3] << 8;
+                int bits = body[14] | body[15] << 8;
+                if (format != 1 || channels != 1 || bits != 16) die("need 16-bit mono PCM WAV", file);
+                if (rate <= 0) rate = le32(body + 4);
+                ok_fmt = 1;
+            } else if (!memcmp(buf + off, "data", 4)) {
+                pcm = body;
+                pcm_len = size;
+            }
+            off += 8 + size + (size & 1);
+        }
+        if (!ok_fmt || !pcm) die("incomplete WAV", file);
+    }
+
+    it->e.type = ASSET_SOUND;
+    it->e.param = rate > 0 ? rate : 22050;
+    it->e.size = pcm_len & ~1u;
+    it->data = malloc(it->e.size ? it->e.size : 1);
+    memcpy(it->data, pcm, it->e.size);
+    free(buf);
+}
+
+static int cmp_items(const void *a, const void *b) {
+    const Item *x = a, *y = b;
+    if (x->e.hash != y->e.hash) return x->e.hash < y->e.hash ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+static void parse_manifest(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    const char *slash = strrchr(path, '/');
+    if (slash) snprintf(base_dir, sizeof(base_dir), "%.*s/", (int)(slash - path), path);
+
+    int align = 4;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        char kind[16], name[64], a1[256] = "", a2[64] = "", a3[64] = "", a4[64] = "";
+        int n = sscanf(line, "%15s %63s %255s %63s %63s %63s", kind, name, a1, a2, a3, a4);
+        if (n <= 0) continue;
+        if (!strcmp(kind, "align")) {
+            align = atoi(name);
+            if (align < 2 || align % 2) die("bad align", name);
+            continue;
+        }
+        if (n < 3) die("missing arguments", kind);
+        if (num_items == MAX_ASSETS) die("too many assets", NULL);
+
+        Item *it = &items[num_items++];
+        memset(it, 0, sizeof(*it));
+        snprintf(it->name, sizeof(it->name), "%s", name);
+        it->e.hash = asset_hash(name);
+
+        if (!strcmp(kind, "image")) {
+            add_image(it, a1, n >= 4 ? atoi(a2) : 0, align);
+        } else if (!strcmp(kind, "font")) {
+            if (n < 5) die("font needs SCALE FG BG", name);
+            add_font(it, atoi(a1), strtoul(a2, NULL, 16), strtoul(a3, NULL, 16),
+                     n >= 6 && !strcmp(a4, "opaque"));
+        } else if (!strcmp(kind, "sound")) {
+            add_sound(it, a1, n >= 4 ? atoi(a2) : 0);
+        } else if (!strcmp(kind, "raw")) {
+            size_t len;
+            it->e.type = ASSET_RAW;
+            it->data = read_file(a1, &len);
+            it->e.size = len;
+        } else {
+            die("unknown asset kind", kind);
+        }
+    }
+    fclose(f);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: mkpack MANIFEST OUT.pak\n");
+        return 2;
+    }
+    parse_manifest(argv[1]);
+
+    qsort(items, num_items, sizeof(items[0]), cmp_items);
+    for (int i = 1; i < num_items; i++) {
+        if (!strcmp(items[i].name, items[i - 1].name)) {
+            fprintf(stderr, "mkpack: duplicate asset %s\n", items[i].name);
+            return 1;
+        }
+    }
+
+    // Layout: header, entry table, names, then aligned data
+    uint32_t off = sizeof(AssetHeader) + num_items * sizeof(AssetEntry);
+    for (int i = 0; i < num_items; i++) {
+        items[i].e.name = off;
+        off += strlen(items[i].name) + 1;
+    }
+    for (int i = 0; i < num_items; i++) {
+        off = (off + ASSET_DATA_ALIGN - 1) / ASSET_DATA_ALIGN * ASSET_DATA_ALIGN;
+        items[i].e.offset = off;
+        off += items[i].e.size;
+    }
+
+    AssetHeader h = { ASSET_MAGIC, ASSET_VERSION, 0, (uint32_t)num_items, off };
+    uint8_t *out = calloc(1, off);
+    memcpy(out, &h, sizeof(h));
+    for (int i = 0; i < num_items; i++) {
+        memcpy(out + sizeof(h) + i * sizeof(AssetEntry), &items[i].e, sizeof(AssetEntry));
+        strcpy((char *)out + items[i].e.name, items[i].name);
+        memcpy(out + items[i].e.offset, items[i].data, items[i].e.size);
+        free(items[i].data);
+    }
+
+    FILE *f = fopen(argv[2], "wb");
+    if (!f || fwrite(out, 1, off, f) != off || fclose(f) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    free(out);
+    printf("mkpack: %d assets, %u bytes -> %s\n", num_items, off, argv[2]);
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "ui.h"
+#include "gfx.h"
+
+void ui_init(UiTree *t, Surface *surf) {
+    memset(t, 0, sizeof(*t));
+    t->surf = surf;
+}
+
+void ui_free(UiTree *t) {
+    for (int i = 0; i < t->count; i++) {
+        free(t->widgets[i].row_shown);
+        t->widgets[i].row_shown = NULL;
+    }
+    t->count = 0;
+}
+
+static UiWidget *add_widget(UiTree *t, UiKind kind, UiWidget *parent,
+                            int x, int y, int w, int h) {
+    if (t->count == UI_MAX_WIDGETS) return NULL;
+    UiWidget *wd = &t->widgets[t->count++];
+    memset(wd, 0, sizeof(*wd));
+    wd->kind = kind;
+    wd->parent = parent;
+    wd->rect.x = x;
+    wd->rect.y = y;
+    wd->rect.w = w;
+    wd->rect.h = h;
+    wd->bg = parent ? parent->bg : 0;
+    wd->dirty = 1;
+    wd->full = 1;
+    return wd;
+}
+
+UiWidget *ui_panel(UiTree *t, UiWidget *parent, int x, int y, int w, int h, uint16_t bg) {
+    UiWidget *wd = add_widget(t, UI_PANEL, parent, x, y, w, h);
+    if (wd) wd->bg = bg;
+    return wd;
+}
+
+UiWidget *ui_label(UiTree *t, UiWidget *parent, int x, int y, int w,
+                   const GlyphAtlas *font, UiAlign align) {
+    if (!font) return NULL;
+    UiWidget *wd = add_widget(t, UI_LABEL, parent, x, y, w, font->cell_h);
+    if (!wd) return NULL;
+    wd->font = font;
+    wd->align = align;
+    if (font->opaque) wd->bg = font->bg;
+    return wd;
+}
+
+UiWidget *ui_list(UiTree *t, UiWidget *parent, int x, int y, int w, int h,
+                  const GlyphAtlas *font, const GlyphAtlas *sel_font,
+                  UiListTextFn item_text, void *user) {
+    if (!font) return NULL;
+    UiWidget *wd = add_widget(t, UI_LIST, parent, x, y, w, h);
+    if (!wd) return NULL;
+    wd->font = font;
+    wd->sel_font = sel_font ? sel_font : font;
+    wd->item_text = item_text;
+    wd->user = user;
+    wd->selected = -1;
+    if (font->opaque) wd->bg = font->bg;
+
+    wd->rows = h / font->cell_h;
+    if (wd->rows > UI_LIST_MAX_ROWS) wd->rows = UI_LIST_MAX_ROWS;
+    wd->row_shown = calloc(wd->rows ? wd->rows : 1, UI_TEXT_MAX);
+    if (!wd->row_shown) {
+        t->count--;
+        return NULL;
+    }
+    return wd;
+}
+
+/* Cells that fit in the widget's width */
+static int max_cells(const UiWidget *w, const GlyphAtlas *font) {
+    int n = w->rect.w / font->cell_w;
+    return n < UI_TEXT_MAX - 1 ? n : UI_TEXT_MAX - 1;
+}
+
+void ui_label_set(UiWidget *w, const char *text) {
+    if (!w || strncmp(w->text, text, sizeof(w->text) - 1) == 0) return;
+    snprintf(w->text, sizeof(w->text), "%s", text);
+    w->dirty = 1;
+}
+
+void ui_label_printf(UiWidget *w, const char *fmt, ...) {
+    char buf[UI_TEXT_MAX];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    ui_label_set(w, buf);
+}
+
+void ui_list_set_count(UiWidget *w, int count) {
+    if (!w || w->count == count) return;
+    w->count = count;
+    if (w->selected >= count) w->selected = count - 1;
+    if (w->top > count - w->rows) w->top = count - w->rows > 0 ? count - w->rows : 0;
+    w->dirty = 1;
+}
+
+void ui_list_select(UiWidget *w, int index) {
+    if (!w) return;
+    if (index >= w->count) index = w->count - 1;
+    if (index < 0) index = w->count ? 0 : -1;
+    if (index == w->selected) return;
+    w->selected = index;
+
+    // Scroll just enough to keep the selection on screen
+    if (index >= 0 && index < w->top) w->top = index;
+    if (index >= w->top + w->rows) w->top = index - w->rows + 1;
+    w->dirty = 1;
+}
+
+void ui_list_changed(UiWidget *w) {
+    if (w) w->dirty = 1;
+}
+
+void ui_invalidate(UiTree *t, UiWidget *w) {
+    // Descendants come after their parent in the pool
+    for (int i = (int)(w - t->widgets); i < t->count; i++) {
+        UiWidget *c = &t->widgets[i];
+        for (UiWidget *a = c; a; a = a->parent) {
+            if (a == w) {
+                c->dirty = 1;
+                c->full = 1;
+                break;
+            }
+        }
+    }
+}
+
+/* Fill cells [c0, c1) of a text line with the background */
+static void clear_cells(UiTree *t, int x, int y, int c0, int c1, const GlyphAtlas *font, uint16_t bg) {
+    gfx_fill(&t->surf->back, x + c0 * font->cell_w, y, (c1 - c0) * font->cell_w, font->cell_h, bg);
+}
+
+/* Bring one line of text on screen from `shown` to `text`
+ * Only runs of cells that differ are drawn and damaged; cells past the end
+ * of the new text that held old text are cleared. `shown` is updated.
+ */
+static void draw_cells(UiTree *t, int x, int y, char *shown, const char *text, int cells,
+                       const GlyphAtlas *font, uint16_t bg) {
+    int n_new = (int)strnlen(text, cells);
+    int n_old = (int)strlen(shown);
+    int n = n_new > n_old ? n_new : n_old;
+
+    int i = 0;
+    while (i < n) {
+        char now = i < n_new ? text[i] : '\0';
+        if (now == shown[i]) {
+            i++;
+            continue;
+        }
+
+        // Extend the run over every following cell that also changed
+        int j = i + 1;
+        while (j < n && (j < n_new ? text[j] : '\0') != shown[j]) j++;
+
+        int draw_end = j < n_new ? j : n_new;
+        if (draw_end > i) {
+            char run[UI_TEXT_MAX];
+            memcpy(run, text + i, draw_end - i);
+            run[draw_end - i] = '\0';
+            if (!font->opaque) clear_cells(t, x, y, i, draw_end, font, bg);
+            draw_text(&t->surf->back, x + i * font->cell_w, y, run, font);
+        }
+        if (j > draw_end) clear_cells(t, x, y, draw_end > i ? draw_end : i, j, font, bg);
+
+        surface_damage(t->surf, x + i * font->cell_w, y, (j - i) * font->cell_w, font->cell_h);
+        t->cells_drawn += j - i;
+        i = j;
+    }
+
+    memcpy(shown, text, n_new);
+    memset(shown + n_new, 0, UI_TEXT_MAX - n_new);
+}
+
+static void render_label(UiTree *t, UiWidget *w) {
+    int cells = max_cells(w, w->font);
+    int len = (int)strnlen(w->text, cells);
+    int x = w->rect.x;
+    if (w->align == UI_ALIGN_CENTER) x += (w->rect.w - len * w->font->cell_w) / 2;
+
+    // Moved text shares no cells with what is on screen
+    if (!w->full && x != w->shown_x) {
+        int old_len = (int)strlen(w->shown);
+        gfx_fill(&t->surf->back, w->shown_x, w->rect.y, old_len * w->font->cell_w,
+                 w->font->cell_h, w->bg);
+        surface_damage(t->surf, w->shown_x, w->rect.y, old_len * w->font->cell_w, w->font->cell_h);
+        memset(w->shown, 0, sizeof(w->shown));
+    }
+    if (w->full) {
+        gfx_fill(&t->surf->back, w->rect.x, w->rect.y, w->rect.w, w->rect.h, w->bg);
+        surface_damage(t->surf, w->rect.x, w->rect.y, w->rect.w, w->rect.h);
+        memset(w->shown, 0, sizeof(w->shown));
+    }
+
+    w->shown_x = x;
+    draw_cells(t, x, w->rect.y, w->shown, w->text, cells, w->font, w->bg);
+}
+
+static void render_list(UiTree *t, UiWidget *w) {
+    if (w->full) {
+        gfx_fill(&t->surf->back, w->rect.x, w->rect.y, w->rect.w, w->rect.h, w->bg);
+        surface_damage(t->surf, w->rect.x, w->rect.y, w->rect.w, w->rect.h);
+        memset(w->row_shown, 0, (size_t)w->rows * UI_TEXT_MAX);
+        memset(w->row_sel, 0, sizeof(w->row_sel));
+    }
+
+    int row_h = w->font->cell_h;
+    for (int r = 0; r < w->rows; r++) {
+        int index = w->top + r;
+        int sel = index == w->selected;
+        const GlyphAtlas *font = sel ? w->sel_font : w->font;
+        uint16_t bg = sel && font->opaque ? font->bg : w->bg;
+        int y = w->rect.y + r * row_h;
+
+        // Selection moved onto or off this row: the whole row changes style
+        if (sel != w->row_sel[r]) {
+            gfx_fill(&t->surf->back, w->rect.x, y, w->rect.w, row_h, bg);
+            surface_damage(t->surf, w->rect.x, y, w->rect.w, row_h);
+            memset(w->row_shown[r], 0, UI_TEXT_MAX);
+            w->row_sel[r] = (uint8_t)sel;
+        }
+
+        char text[UI_TEXT_MAX] = "";
+        if (index < w->count && w->item_text) w->item_text(index, text, sizeof(text), w->user);
+        draw_cells(t, w->rect.x, y, w->row_shown[r], text, max_cells(w, font), font, bg);
+    }
+}
+
+int ui_render(UiTree *t) {
+    int drawn = 0;
+    t->cells_drawn = 0;
+    for (int i = 0; i < t->count; i++) {
+        UiWidget *w = &t->widgets[i];
+        if (!w->dirty) continue;
+
+        switch (w->kind) {
+        case UI_PANEL:
+            if (w->full) {
+                gfx_fill(&t->surf->back, w->rect.x, w->rect.y, w->rect.w, w->rect.h, w->bg);
+                surface_damage(t->surf, w->rect.x, w->rect.y, w->rect.w, w->rect.h);
+            }
+            break;
+        case UI_LABEL:
+            render_label(t, w);
+            break;
+        case UI_LIST:
+            render_list(t, w);
+            break;
+        }
+        w->dirty = 0;
+        w->full = 0;
+        drawn = 1;
+    }
+    return drawn;
+}
@@ -0,0 +1,102 @@
+#ifndef TRIMUI_UI_H
+#define TRIMUI_UI_H
+
+#include <stdint.h>
+
+#include "surface.h"
+#include "glyph.h"
+
+#define UI_MAX_WIDGETS   32
+#define UI_TEXT_MAX      64     // cells per label or list row, including the NUL
+#define UI_LIST_MAX_ROWS 32     // visible rows per list
+
+typedef enum {
+    UI_PANEL = 0,       // solid background, parent of other widgets
+    UI_LABEL,           // one line of text
+    UI_LIST,            // scrolling list of rows with one selected
+} UiKind;
+
+typedef enum {
+    UI_ALIGN_LEFT = 0,
+    UI_ALIGN_CENTER,
+} UiAlign;
+
+/* Row text for a list: write item `index` into `buf` */
+typedef void (*UiListTextFn)(int index, char *buf, int len, void *user);
+
+typedef struct UiWidget UiWidget;
+
+struct UiWidget {
+    UiKind kind;
+    Rect rect;                  // screen coordinates
+    UiWidget *parent;           // NULL for a root
+    uint16_t bg;
+    const GlyphAtlas *font;     // labels and lists
+    int dirty;                  // content changed since the last render
+    int full;                   // repaint everything, not just changed cells
+
+    // Label
+    UiAlign align;
+    char text[UI_TEXT_MAX];
+    char shown[UI_TEXT_MAX];    // what is on screen now
+    int shown_x;                // where it was drawn
+
+    // List
+    const GlyphAtlas *sel_font; // style of the selected row
+    UiListTextFn item_text;
+    void *user;
+    int count;
+    int top;                    // first visible item
+    int selected;               // -1 = none
+    int rows;                   // visible rows
+    char (*row_shown)[UI_TEXT_MAX];
+    uint8_t row_sel[UI_LIST_MAX_ROWS];
+};
+
+/* Retained widget tree
+ *
+ * Widgets keep the text they last put on screen. ui_render() repaints only
+ * widgets whose content changed, and within those only the glyph cells that
+ * differ from the last frame, reporting each changed run of cells to the
+ * surface as damage. Widgets are painted in creation order, so a parent must
+ * be created before its children. Fonts should be opaque atlases: changed
+ * cells are then overwritten in place without clearing first.
+ */
+typedef struct {
+    Surface *surf;
+    UiWidget widgets[UI_MAX_WIDGETS];
+    int count;
+    uint32_t cells_drawn;       // glyph cells repainted by the last ui_render()
+} UiTree;
+
+void ui_init(UiTree *t, Surface *surf);
+void ui_free(UiTree *t);
+
+/* Constructors return NULL when the tree is full */
+UiWidget *ui_panel(UiTree *t, UiWidget *parent, int x, int y, int w, int h, uint16_t bg);
+UiWidget *ui_label(UiTree *t, UiWidget *parent, int x, int y, int w,
+                   const GlyphAtlas *font, UiAlign align);
+UiWidget *ui_list(UiTree *t, UiWidget *parent, int x, int y, int w, int h,
+                  const GlyphAtlas *font, const GlyphAtlas *sel_font,
+                  UiListTextFn item_text, void *user);
+
+/* Label text; only marks the label dirty if it actually changed */
+void ui_label_set(UiWidget *w, const char *text);
+void ui_label_printf(UiWidget *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* List contents: item count, selection (scrolls it into view), or the
+ * text of the items changed without the count changing
+ */
+void ui_list_set_count(UiWidget *w, int count);
+void ui_list_select(UiWidget *w, int index);
+void ui_list_changed(UiWidget *w);
+
+/* Repaint a widget and everything inside it from scratch */
+void ui_invalidate(UiTree *t, UiWidget *w);
+
+/* Draw what changed into the surface back buffer and damage it
+ * Returns 1 if anything was drawn.
+ */
+int ui_render(UiTree *t);
+
+#endif